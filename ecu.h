@@ -0,0 +1,232 @@
+/*****************************************************************************
+**
+**  Name:           ecu.h
+**
+**  Description:    libecu, XOR stream encryptor library.
+**                  every stream runs in its own context, contexts share
+**                  nothing and may run in parallel from many threads.
+**
+**                  ctx = ecu_create(key, key_size, &config);
+**                  ecu_process_fd(ctx, in_fd, out_fd, 0);  any times
+**                  ecu_destroy(ctx);
+**
+**                  one context runs one stream at a time. destroy a
+**                  context after a run failed.
+**
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#ifndef ECU_H
+#define ECU_H
+
+#include <stddef.h>
+
+/* wait strategy of idle threads */
+#define ECU_WAIT_SPIN   0   /* busy wait, lowest latency, burns CPU */
+#define ECU_WAIT_HYBRID 1   /* spin briefly, then sleep in kernel */
+#define ECU_WAIT_BLOCK  2   /* sleep in kernel right away */
+
+/* I/O engine of input and output fd */
+#define ECU_IO_SYNC     0   /* read() and writev() */
+#define ECU_IO_SPLICE   1   /* enlarged pipes, direct read and writev() */
+#define ECU_IO_URING    2   /* io_uring, many reads/writes of file in flight */
+
+/* dispatch of blocks to encryptors */
+#define ECU_ENC_DISPATCH_SHARED 0   /* every encryptor pops shared DIST ring */
+#define ECU_ENC_DISPATCH_RR     1   /* block n goes to encryptor n % N,
+                                     * merger takes them back in same order */
+#define ECU_ENC_DISPATCH_STEAL  2   /* encryptors take batches into own deque,
+                                     * idle ones steal from the others */
+
+/* flags of output fd */
+#define ECU_OUT_POSITIONAL  0x01    /* regular file, each block is written
+                                     * at its offset without merger */
+
+/* opaque context of one stream */
+struct ecu_ctx;
+
+/* configuration of a context, set defaults with ecu_config_init() */
+struct ecu_config
+{
+    unsigned int num_of_enc_thread; /* 1 to 256, 0 is CPUs less 2 */
+    unsigned int block_size;        /* 0 is default */
+    unsigned int read_size;         /* size of one read() from input fd */
+    unsigned int flush_size;        /* size of output flushed at once */
+    unsigned int wait_mode;         /* ECU_WAIT_xxx */
+    unsigned int zero_copy;         /* 1 : read input directly into blocks */
+    unsigned int io_engine;         /* ECU_IO_xxx */
+    unsigned int dispatch;          /* ECU_ENC_DISPATCH_xxx */
+    const char *cpus;               /* CPU list like "0-3,8" or "auto",
+                                     * NULL is no pinning */
+    unsigned int keep_threads;      /* 1 : threads are parked between runs
+                                     * until ecu_destroy, not created and
+                                     * joined by every run */
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_config_init
+ **
+ ** Description     set default configuration
+ **
+ ** Parameters      cfg : configuration
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_config_init(struct ecu_config *cfg);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_create
+ **
+ ** Description     create context of a stream. key is copied, keystream
+ **                 and every data block are allocated here
+ **
+ ** Parameters      key : key data
+ **                 key_size : size of key, 1 byte to 16 MiB
+ **                 cfg : configuration, NULL is default
+ **
+ ** Returns         context
+ **                 NULL is error
+ **
+ *******************************************************************************/
+struct ecu_ctx *ecu_create(const unsigned char *key, size_t key_size,
+                           const struct ecu_config *cfg);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_fd
+ **
+ ** Description     encrypt input fd until end of stream into output fd.
+ **                 output is in input order
+ **
+ ** Parameters      ctx : context
+ **                 in_fd : input
+ **                 out_fd : output
+ **                 flags : ECU_OUT_xxx
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_fd(struct ecu_ctx *ctx, int in_fd, int out_fd, unsigned int flags);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer
+ **
+ ** Description     encrypt memory into memory
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 out : output, len bytes. can be same as in
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer(struct ecu_ctx *ctx, const void *in, size_t len, void *out);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer_fd
+ **
+ ** Description     encrypt memory into output fd
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 out_fd : output
+ **                 flags : ECU_OUT_xxx
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer_fd(struct ecu_ctx *ctx, const void *in, size_t len,
+                          int out_fd, unsigned int flags);
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_batch
+ **
+ ** Description     encrypt many files through one pipeline.
+ **                 files are read one after another and every block is
+ **                 tagged by its file, merger writes each output file in
+ **                 order. no file waits for the pipeline to drain
+ **
+ ** Parameters      ctx : context
+ **                 in_path : input files
+ **                 out_path : output files, created or truncated
+ **                 cnt : number of files
+ **
+ ** Returns         0 is success
+ **                 -1 is error, files after the failed one are not written
+ **
+ *******************************************************************************/
+int ecu_process_batch(struct ecu_ctx *ctx, const char *const *in_path,
+                      const char *const *out_path, unsigned int cnt);
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer_at
+ **
+ ** Description     encrypt memory taken from an offset of a stream.
+ **                 keystream of any offset is known without the data
+ **                 before it, so a slice of encrypted stream decrypts alone
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 offset : offset of in[0] in the stream
+ **                 out : output, len bytes. can be same as in
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer_at(struct ecu_ctx *ctx, const void *in, size_t len,
+                          unsigned long long offset, void *out);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_range
+ **
+ ** Description     encrypt a byte range of a seekable input fd into
+ **                 output fd. only the range is read, in calling thread.
+ **                 range past end of input stops at end of input
+ **
+ ** Parameters      ctx : context
+ **                 in_fd : input, regular file or block device
+ **                 offset : first byte of range
+ **                 length : length of range
+ **                 out_fd : output
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_range(struct ecu_ctx *ctx, int in_fd, unsigned long long offset,
+                      unsigned long long length, int out_fd);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_destroy
+ **
+ ** Description     free context
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_destroy(struct ecu_ctx *ctx);
+
+#endif
@@ -0,0 +1,956 @@
+/*****************************************************************************
+**
+**  Name:           ecu_bench.c
+**
+**  Description:    throughput benchmark of libecu, "make bench".
+**                  synthetic input is generated in memory and run through
+**                  - kernel : XOR of one block in place with keystream of
+**                             its offset, as an encryptor does, per kernel
+**                  - pipeline : distributor, encryptors and merger over
+**                               pipes or memory files, or encryptors only
+**                               for memory buffer
+**                  sweeping thread count, key size, block size, I/O mode
+**                  and dispatch. output of each case is checked once
+**                  against scalar kernel. result is one JSON object on
+**                  stdout, exit status is 1 if any case failed.
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "ecu.h"
+#include "ecu_ctx.h"
+#include "ecu_xor.h"
+#include "ecu_io.h"
+#include "ecu_dist.h"
+#include "ecu_enc.h"
+#include "ecu_cpu.h"
+
+
+/* Default input size of one run (byte) */
+#define ECU_BENCH_DEFAULT_SIZE (128*1024*1024)
+
+/* Default runs of each case, best one is reported */
+#define ECU_BENCH_DEFAULT_REPEAT 3
+
+/* I/O modes of pipeline */
+#define ECU_BENCH_IO_SYNC   0   /* pipe in, pipe out, read() and writev() */
+#define ECU_BENCH_IO_SPLICE 1   /* enlarged pipe in and out, writev() */
+#define ECU_BENCH_IO_URING  2   /* memory file in and out, io_uring */
+#define ECU_BENCH_IO_BUFFER 3   /* memory to memory, encryptors only */
+
+/* pipeline case */
+struct ecu_bench_case
+{
+    unsigned int io;
+    unsigned int threads;       /* 0 is number of CPUs less 2 */
+    unsigned int key_size;
+    unsigned int block_size;    /* 0 is default */
+    unsigned int dispatch;
+};
+
+/* measured run */
+struct ecu_bench_result
+{
+    unsigned long long bytes;
+    unsigned long long ns;
+    unsigned long long cycles;  /* 0 if no cycle counter */
+    int ok;                     /* 1 if output matches scalar kernel */
+};
+
+/* writer of pipeline input */
+struct ecu_bench_feed
+{
+    int fd;
+    const unsigned char *data;
+    size_t len;
+    int result;
+};
+
+/* reader of pipeline output, into ecu_bench_out */
+struct ecu_bench_sink
+{
+    int fd;
+    unsigned long long len;
+    int result;
+};
+
+
+/* static function definitions */
+static void ecu_bench_help();
+static unsigned long long ecu_bench_now();
+static unsigned long long ecu_bench_cycles();
+static void ecu_bench_fill(unsigned char *data, size_t len, unsigned long long seed);
+static unsigned char *ecu_bench_key(unsigned int key_size);
+static int ecu_bench_block_ok(unsigned int key_size, unsigned int block_size);
+static void ecu_bench_reference(struct ecu_ctx *ctx, unsigned int key_size);
+static int ecu_bench_check(struct ecu_ctx *ctx, unsigned int key_size);
+static void *ecu_bench_feed_thread(void *ptr);
+static void *ecu_bench_sink_thread(void *ptr);
+static int ecu_bench_run_pipe(struct ecu_ctx *ctx, struct ecu_bench_result *res);
+static int ecu_bench_run_file(struct ecu_ctx *ctx, struct ecu_bench_result *res);
+static int ecu_bench_pipeline(const char *sweep, const struct ecu_bench_case *c);
+static int ecu_bench_kernel(const char *sweep, const char *kernel,
+                            unsigned int key_size, unsigned int block_size);
+static void ecu_bench_print(const char *bench, const char *sweep, const char *extra,
+                            const struct ecu_bench_result *res);
+
+
+/* benchmark input, output of case and expected output */
+static unsigned char *ecu_bench_data;
+static unsigned char *ecu_bench_out;
+static unsigned char *ecu_bench_ref;
+static unsigned int ecu_bench_ref_key = 0;     /* key size of ecu_bench_ref */
+static size_t ecu_bench_size = ECU_BENCH_DEFAULT_SIZE;
+static unsigned int ecu_bench_repeat = ECU_BENCH_DEFAULT_REPEAT;
+
+/* 1 after first result, results are separated by comma */
+static int ecu_bench_printed = 0;
+
+static const char *ecu_bench_io_name[] = { "sync", "splice", "uring", "buffer" };
+static const char *ecu_bench_dispatch_name[] = { "shared", "rr", "steal" };
+static const char *ecu_bench_kernels[] = { "scalar", "sse2", "avx2", "avx512" };
+static const unsigned int ecu_bench_key_sizes[] = { 1, 16, 256, 4096, 65536, 1024*1024 };
+static const unsigned int ecu_bench_block_sizes[] = { 4096, 16384, 65536, 262144, 1024*1024 };
+
+#define ECU_BENCH_NUM(a) (sizeof(a) / sizeof((a)[0]))
+
+
+
+/*******************************************************************************
+ **
+ ** Function        main
+ **
+ ** Description     run every sweep and print JSON
+ **
+ ** Parameters      Program's arguments
+ **
+ ** Returns         status
+ **
+ *******************************************************************************/
+int main(int argc, char **argv)
+{
+    struct ecu_bench_case c;
+    unsigned int max_threads;
+    unsigned int i, k;
+    int result = 0;
+    int opt;
+
+    max_threads = ecu_cpu_count();
+    while( (opt = getopt(argc, argv, "s:t:r:")) != -1 )
+    {
+        switch(opt)
+        {
+        case 's':
+            ecu_bench_size = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            max_threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            ecu_bench_repeat = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            ecu_bench_help();
+            return 1;
+        }
+    }
+    if( (ecu_bench_size == 0) || (ecu_bench_size > 0xFFFFFFFFULL) ||
+        (max_threads == 0) || (max_threads > ECU_ENC_MAX_THREAD_NUM) ||
+        (ecu_bench_repeat == 0) )
+    {
+        ecu_bench_help();
+        return 1;
+    }
+
+    ecu_bench_data = malloc(ecu_bench_size);
+    ecu_bench_out = malloc(ecu_bench_size);
+    ecu_bench_ref = malloc(ecu_bench_size);
+    if( (ecu_bench_data == NULL) || (ecu_bench_out == NULL) || (ecu_bench_ref == NULL) )
+    {
+        fprintf(stderr, "bench alloc error!\n");
+        return 1;
+    }
+    ecu_bench_fill(ecu_bench_data, ecu_bench_size, 1);
+    memset(ecu_bench_out, 0, ecu_bench_size);
+
+    ecu_xor_init();
+
+    printf("{\n");
+    printf("  \"tool\": \"encryptUtil\",\n");
+    printf("  \"version\": \"2.0\",\n");
+    printf("  \"cpus\": %u,\n", ecu_cpu_count());
+    printf("  \"xor_kernel\": \"%s\",\n", ecu_xor_get_name());
+    printf("  \"input_size\": %zu,\n", ecu_bench_size);
+    printf("  \"repeat\": %u,\n", ecu_bench_repeat);
+    printf("  \"cycles_source\": \"%s\",\n", ecu_bench_cycles() ? "tsc" : "none");
+    printf("  \"results\": [\n");
+
+    /* kernel alone, every kernel this CPU has */
+    for( k = 0 ; k < ECU_BENCH_NUM(ecu_bench_kernels) ; k++ )
+    {
+        if( ecu_xor_get_kernel(ecu_bench_kernels[k]) == NULL )
+        {
+            continue;
+        }
+        for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_key_sizes) ; i++ )
+        {
+            result |= ecu_bench_kernel("key_size", ecu_bench_kernels[k],
+                                       ecu_bench_key_sizes[i], 0);
+        }
+        for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_block_sizes) ; i++ )
+        {
+            result |= ecu_bench_kernel("block_size", ecu_bench_kernels[k],
+                                       16, ecu_bench_block_sizes[i]);
+        }
+    }
+
+    /* pipeline, one parameter at a time from default case */
+    memset(&c, 0, sizeof(c));
+    c.io = ECU_BENCH_IO_SYNC;
+    c.key_size = 16;
+    c.dispatch = ECU_ENC_DISPATCH_SHARED;
+
+    for( i = 1 ; ; i *= 2 )
+    {
+        c.threads = (i < max_threads) ? i : max_threads;
+        result |= ecu_bench_pipeline("threads", &c);
+        if( c.threads == max_threads )
+        {
+            break;
+        }
+    }
+    c.threads = 0;
+
+    for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_key_sizes) ; i++ )
+    {
+        c.key_size = ecu_bench_key_sizes[i];
+        result |= ecu_bench_pipeline("key_size", &c);
+    }
+    c.key_size = 16;
+
+    for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_block_sizes) ; i++ )
+    {
+        c.block_size = ecu_bench_block_sizes[i];
+        result |= ecu_bench_pipeline("block_size", &c);
+    }
+    c.block_size = 0;
+
+    for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_io_name) ; i++ )
+    {
+        c.io = i;
+        result |= ecu_bench_pipeline("io", &c);
+    }
+    c.io = ECU_BENCH_IO_SYNC;
+
+    for( i = 0 ; i < ECU_BENCH_NUM(ecu_bench_dispatch_name) ; i++ )
+    {
+        c.dispatch = i;
+        result |= ecu_bench_pipeline("dispatch", &c);
+    }
+
+    printf("\n  ]\n");
+    printf("}\n");
+
+    free(ecu_bench_data);
+    free(ecu_bench_out);
+    free(ecu_bench_ref);
+    return result ? 1 : 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_help
+ **
+ ** Description     Display how to use ecuBench
+ **
+ ** Parameters      none
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_bench_help()
+{
+    fprintf(stderr, "usage\n");
+    fprintf(stderr, " ecuBench [-s bytes] [-t threads] [-r repeat]\n");
+    fprintf(stderr, " -s bytes Input size of one run. default %d\n", ECU_BENCH_DEFAULT_SIZE);
+    fprintf(stderr, " -t threads Most encryptor threads of thread sweep, 1 to %d. default CPUs\n",
+            ECU_ENC_MAX_THREAD_NUM);
+    fprintf(stderr, " -r repeat Runs of each case, best is reported. default %d\n",
+            ECU_BENCH_DEFAULT_REPEAT);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_now
+ **
+ ** Description     get monotonic time
+ **
+ ** Parameters      none
+ **
+ ** Returns         time (ns)
+ **
+ *******************************************************************************/
+static unsigned long long ecu_bench_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_cycles
+ **
+ ** Description     get time stamp counter. it ticks at nominal frequency
+ **                 of CPU, not at turbo or power saving frequency
+ **
+ ** Parameters      none
+ **
+ ** Returns         cycles
+ **                 0 if CPU has no cycle counter
+ **
+ *******************************************************************************/
+static unsigned long long ecu_bench_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_fill
+ **
+ ** Description     fill buffer with pseudo random bytes, xorshift64
+ **
+ ** Parameters      data : buffer
+ **                 len : length of buffer
+ **                 seed : seed, not 0
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_bench_fill(unsigned char *data, size_t len, unsigned long long seed)
+{
+    unsigned long long x = seed;
+    size_t i;
+
+    for( i = 0 ; i < len ; i++ )
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (unsigned char)x;
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_key
+ **
+ ** Description     make synthetic key
+ **
+ ** Parameters      key_size : size of key
+ **
+ ** Returns         key, caller frees it
+ **                 NULL is error
+ **
+ *******************************************************************************/
+static unsigned char *ecu_bench_key(unsigned int key_size)
+{
+    unsigned char *key;
+
+    key = malloc(key_size);
+    if( key == NULL )
+    {
+        fprintf(stderr, "key alloc error!\n");
+        return NULL;
+    }
+    ecu_bench_fill(key, key_size, 0x9E3779B97F4A7C15ULL + key_size);
+
+    return key;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_block_ok
+ **
+ ** Description     check block size fits key rotation period,
+ **                 same rule as ecu_create
+ **
+ ** Parameters      key_size : size of key
+ **                 block_size : size of block, 0 is default
+ **
+ ** Returns         1 is valid
+ **                 0 is not
+ **
+ *******************************************************************************/
+static int ecu_bench_block_ok(unsigned int key_size, unsigned int block_size)
+{
+    unsigned long long period = (unsigned long long)key_size * 8;
+
+    return (block_size == 0) || (period > ECU_BLOCK_DEFAULT_SIZE) ||
+           ((block_size % period) == 0);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_reference
+ **
+ ** Description     encrypt whole input into ecu_bench_ref with scalar kernel,
+ **                 block by block like an encryptor. output depends on key
+ **                 only, so it is kept until key size changes
+ **
+ ** Parameters      ctx : context of the key
+ **                 key_size : size of key
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_bench_reference(struct ecu_ctx *ctx, unsigned int key_size)
+{
+    ecu_xor_fn fn = ecu_xor_get_kernel("scalar");
+    unsigned int block_size = ecu_get_block_size(ctx);
+    unsigned long long offset;
+    unsigned int len;
+
+    if( ecu_bench_ref_key == key_size )
+    {
+        return;
+    }
+
+    for( offset = 0 ; offset < ecu_bench_size ; offset += len )
+    {
+        len = block_size;
+        if( ecu_bench_size - offset < len )
+        {
+            len = (unsigned int)(ecu_bench_size - offset);
+        }
+        fn(ecu_bench_ref + offset, ecu_bench_data + offset,
+           ecu_get_keystream(ctx, offset), len);
+    }
+    ecu_bench_ref_key = key_size;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_check
+ **
+ ** Description     compare ecu_bench_out with output of scalar kernel
+ **
+ ** Parameters      ctx : context of the key
+ **                 key_size : size of key
+ **
+ ** Returns         1 is same
+ **                 0 is not
+ **
+ *******************************************************************************/
+static int ecu_bench_check(struct ecu_ctx *ctx, unsigned int key_size)
+{
+    size_t i;
+
+    ecu_bench_reference(ctx, key_size);
+    if( memcmp(ecu_bench_out, ecu_bench_ref, ecu_bench_size) == 0 )
+    {
+        return 1;
+    }
+
+    for( i = 0 ; ecu_bench_out[i] == ecu_bench_ref[i] ; i++ )
+    {
+    }
+    fprintf(stderr, "output differs from scalar kernel at byte %zu, key size %u\n",
+            i, key_size);
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_feed_thread
+ **
+ ** Description     write whole input to pipe, then close it
+ **
+ ** Parameters      ptr : struct ecu_bench_feed
+ **
+ ** Returns         NULL
+ **
+ *******************************************************************************/
+static void *ecu_bench_feed_thread(void *ptr)
+{
+    struct ecu_bench_feed *feed = ptr;
+    const unsigned char *data = feed->data;
+    size_t len = feed->len;
+    ssize_t result;
+
+    while( len > 0 )
+    {
+        result = write(feed->fd, data, len);
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            feed->result = -1;
+            break;
+        }
+        data += result;
+        len -= (size_t)result;
+    }
+    close(feed->fd);
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_sink_thread
+ **
+ ** Description     read pipe until end of stream into ecu_bench_out
+ **                 and count bytes. bytes over input size are dropped
+ **
+ ** Parameters      ptr : struct ecu_bench_sink
+ **
+ ** Returns         NULL
+ **
+ *******************************************************************************/
+static void *ecu_bench_sink_thread(void *ptr)
+{
+    struct ecu_bench_sink *sink = ptr;
+    unsigned char *buf;
+    unsigned char *dst;
+    size_t size;
+    ssize_t len;
+
+    buf = malloc(ECU_DIST_READ_SIZE);
+    if( buf == NULL )
+    {
+        sink->result = -1;
+        return NULL;
+    }
+
+    while( 1 )
+    {
+        dst = buf;
+        size = ECU_DIST_READ_SIZE;
+        if( sink->len < ecu_bench_size )
+        {
+            dst = ecu_bench_out + sink->len;
+            if( ecu_bench_size - sink->len < size )
+            {
+                size = (size_t)(ecu_bench_size - sink->len);
+            }
+        }
+        len = read(sink->fd, dst, size);
+        if( len < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            sink->result = -1;
+            break;
+        }
+        if( len == 0 )
+        {
+            break;
+        }
+        sink->len += (unsigned long long)len;
+    }
+    free(buf);
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_run_pipe
+ **
+ ** Description     run input through pipe into context and output
+ **                 through pipe into a reader thread
+ **
+ ** Parameters      ctx : context
+ **                 res : measured run
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_bench_run_pipe(struct ecu_ctx *ctx, struct ecu_bench_result *res)
+{
+    struct ecu_bench_feed feed;
+    struct ecu_bench_sink sink;
+    pthread_t feed_tid, sink_tid;
+    unsigned long long start, cyc;
+    int in_pipe[2], out_pipe[2];
+    int result;
+
+    if( pipe2(in_pipe, O_CLOEXEC) )
+    {
+        return -1;
+    }
+    if( pipe2(out_pipe, O_CLOEXEC) )
+    {
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return -1;
+    }
+
+    feed.fd = in_pipe[1];
+    feed.data = ecu_bench_data;
+    feed.len = ecu_bench_size;
+    feed.result = 0;
+    sink.fd = out_pipe[0];
+    sink.len = 0;
+    sink.result = 0;
+
+    start = ecu_bench_now();
+    cyc = ecu_bench_cycles();
+    pthread_create(&feed_tid, NULL, ecu_bench_feed_thread, &feed);
+    pthread_create(&sink_tid, NULL, ecu_bench_sink_thread, &sink);
+
+    result = ecu_process_fd(ctx, in_pipe[0], out_pipe[1], 0);
+    close(out_pipe[1]);
+
+    pthread_join(feed_tid, NULL);
+    pthread_join(sink_tid, NULL);
+    res->ns = ecu_bench_now() - start;
+    res->cycles = ecu_bench_cycles() - cyc;
+    res->bytes = sink.len;
+    close(in_pipe[0]);
+    close(out_pipe[0]);
+
+    if( result || feed.result || sink.result || (sink.len != ecu_bench_size) )
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_run_file
+ **
+ ** Description     run memory file through context into memory file,
+ **                 then read output into ecu_bench_out
+ **
+ ** Parameters      ctx : context
+ **                 res : measured run
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_bench_run_file(struct ecu_ctx *ctx, struct ecu_bench_result *res)
+{
+    unsigned long long start, cyc;
+    int in_fd, out_fd;
+    int result = -1;
+
+    in_fd = memfd_create("ecu_bench_in", MFD_CLOEXEC);
+    out_fd = memfd_create("ecu_bench_out", MFD_CLOEXEC);
+    if( (in_fd >= 0) && (out_fd >= 0) &&
+        (ecu_io_pwrite(in_fd, ecu_bench_data, (unsigned int)ecu_bench_size, 0) == 0) )
+    {
+        start = ecu_bench_now();
+        cyc = ecu_bench_cycles();
+        result = ecu_process_fd(ctx, in_fd, out_fd, 0);
+        res->ns = ecu_bench_now() - start;
+        res->cycles = ecu_bench_cycles() - cyc;
+        res->bytes = (unsigned long long)lseek(out_fd, 0, SEEK_CUR);
+        if( (res->bytes != ecu_bench_size) ||
+            (ecu_io_pread(out_fd, ecu_bench_out, (unsigned int)ecu_bench_size, 0) !=
+             (int)ecu_bench_size) )
+        {
+            result = -1;
+        }
+    }
+
+    if( in_fd >= 0 )
+    {
+        close(in_fd);
+    }
+    if( out_fd >= 0 )
+    {
+        close(out_fd);
+    }
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_pipeline
+ **
+ ** Description     run a pipeline case repeat times with one context,
+ **                 print best run
+ **
+ ** Parameters      sweep : name of swept parameter
+ **                 c : case
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_bench_pipeline(const char *sweep, const struct ecu_bench_case *c)
+{
+    struct ecu_bench_result res, best;
+    struct ecu_config cfg;
+    struct ecu_ctx *ctx;
+    unsigned long long start, cyc;
+    unsigned char *key;
+    unsigned int i;
+    char extra[256];
+    int result = 0;
+
+    if( ecu_bench_block_ok(c->key_size, c->block_size) == 0 )
+    {
+        return 0;
+    }
+
+    ecu_config_init(&cfg);
+    cfg.num_of_enc_thread = c->threads;
+    cfg.block_size = c->block_size;
+    cfg.dispatch = c->dispatch;
+    if( c->io == ECU_BENCH_IO_SPLICE )
+    {
+        cfg.io_engine = ECU_IO_SPLICE;
+    }
+    else if( c->io == ECU_BENCH_IO_URING )
+    {
+        cfg.io_engine = ECU_IO_URING;
+    }
+
+    key = ecu_bench_key(c->key_size);
+    if( key == NULL )
+    {
+        return -1;
+    }
+    ctx = ecu_create(key, c->key_size, &cfg);
+    free(key);
+    if( ctx == NULL )
+    {
+        return -1;
+    }
+
+    memset(&best, 0, sizeof(best));
+    for( i = 0 ; (i < ecu_bench_repeat) && (result == 0) ; i++ )
+    {
+        memset(&res, 0, sizeof(res));
+        if( c->io == ECU_BENCH_IO_BUFFER )
+        {
+            start = ecu_bench_now();
+            cyc = ecu_bench_cycles();
+            result = ecu_process_buffer(ctx, ecu_bench_data, ecu_bench_size, ecu_bench_out);
+            res.ns = ecu_bench_now() - start;
+            res.cycles = ecu_bench_cycles() - cyc;
+            res.bytes = ecu_bench_size;
+        }
+        else if( c->io == ECU_BENCH_IO_URING )
+        {
+            result = ecu_bench_run_file(ctx, &res);
+        }
+        else
+        {
+            result = ecu_bench_run_pipe(ctx, &res);
+        }
+
+        if( (best.ns == 0) || (res.ns < best.ns) )
+        {
+            best = res;
+        }
+    }
+
+    /* output of last run */
+    if( result == 0 )
+    {
+        best.ok = ecu_bench_check(ctx, c->key_size);
+    }
+
+    snprintf(extra, sizeof(extra),
+             "\"io\": \"%s\", \"threads\": %u, \"key_size\": %u, \"block_size\": %u, "
+             "\"dispatch\": \"%s\", ",
+             ecu_bench_io_name[c->io], ecu_get_num_of_enc_thread(ctx), c->key_size,
+             ecu_get_block_size(ctx), ecu_bench_dispatch_name[c->dispatch]);
+    ecu_destroy(ctx);
+
+    if( result )
+    {
+        fprintf(stderr, "pipeline run failed, %s\n", extra);
+        return -1;
+    }
+    ecu_bench_print("pipeline", sweep, extra, &best);
+
+    return best.ok ? 0 : -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_kernel
+ **
+ ** Description     XOR one block in place with keystream of its offset
+ **                 for input size bytes, as an encryptor does for every
+ **                 block. block stays in cache, so only kernel is measured.
+ **                 whole input is encrypted once first and checked
+ **
+ ** Parameters      sweep : name of swept parameter
+ **                 kernel : name of XOR kernel
+ **                 key_size : size of key
+ **                 block_size : size of block, 0 is default
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_bench_kernel(const char *sweep, const char *kernel,
+                            unsigned int key_size, unsigned int block_size)
+{
+    struct ecu_bench_result res, best;
+    struct ecu_config cfg;
+    struct ecu_ctx *ctx;
+    ecu_xor_fn fn;
+    unsigned long long start, cyc, offset;
+    unsigned char *key;
+    unsigned int i, len;
+    char extra[256];
+    int ok;
+
+    if( ecu_bench_block_ok(key_size, block_size) == 0 )
+    {
+        return 0;
+    }
+
+    fn = ecu_xor_get_kernel(kernel);
+    key = ecu_bench_key(key_size);
+    if( (fn == NULL) || (key == NULL) )
+    {
+        free(key);
+        return -1;
+    }
+
+    /* context only builds keystream, one encryptor keeps pool small */
+    ecu_config_init(&cfg);
+    cfg.num_of_enc_thread = 1;
+    cfg.block_size = block_size;
+    ctx = ecu_create(key, key_size, &cfg);
+    free(key);
+    if( ctx == NULL )
+    {
+        return -1;
+    }
+    block_size = ecu_get_block_size(ctx);
+
+    for( offset = 0 ; offset < ecu_bench_size ; offset += len )
+    {
+        len = block_size;
+        if( ecu_bench_size - offset < len )
+        {
+            len = (unsigned int)(ecu_bench_size - offset);
+        }
+        fn(ecu_bench_out + offset, ecu_bench_data + offset,
+           ecu_get_keystream(ctx, offset), len);
+    }
+    ok = ecu_bench_check(ctx, key_size);
+
+    memset(&best, 0, sizeof(best));
+    for( i = 0 ; i < ecu_bench_repeat ; i++ )
+    {
+        start = ecu_bench_now();
+        cyc = ecu_bench_cycles();
+        for( offset = 0 ; offset < ecu_bench_size ; offset += len )
+        {
+            len = block_size;
+            if( ecu_bench_size - offset < len )
+            {
+                len = (unsigned int)(ecu_bench_size - offset);
+            }
+            fn(ecu_bench_out, ecu_bench_out, ecu_get_keystream(ctx, offset), len);
+        }
+        res.ns = ecu_bench_now() - start;
+        res.cycles = ecu_bench_cycles() - cyc;
+        res.bytes = ecu_bench_size;
+
+        if( (best.ns == 0) || (res.ns < best.ns) )
+        {
+            best = res;
+        }
+    }
+    ecu_destroy(ctx);
+    best.ok = ok;
+
+    snprintf(extra, sizeof(extra),
+             "\"kernel\": \"%s\", \"key_size\": %u, \"block_size\": %u, ",
+             kernel, key_size, block_size);
+    ecu_bench_print("kernel", sweep, extra, &best);
+
+    return ok ? 0 : -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_bench_print
+ **
+ ** Description     print one result as JSON object.
+ **                 "ok" is false if output did not match scalar kernel
+ **
+ ** Parameters      bench : "kernel" or "pipeline"
+ **                 sweep : name of swept parameter
+ **                 extra : parameters of case, JSON members with comma
+ **                 res : best run
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_bench_print(const char *bench, const char *sweep, const char *extra,
+                            const struct ecu_bench_result *res)
+{
+    double sec, gbps;
+
+    sec = (double)res->ns / 1e9;
+    gbps = (res->ns > 0) ? (double)res->bytes / (double)res->ns : 0.0;
+
+    printf("%s    { \"bench\": \"%s\", \"sweep\": \"%s\", %s\"ok\": %s, \"bytes\": %llu, "
+           "\"seconds\": %.6f, \"gbps\": %.3f, ",
+           ecu_bench_printed ? ",\n" : "", bench, sweep, extra,
+           res->ok ? "true" : "false", res->bytes, sec, gbps);
+    if( res->cycles && res->bytes )
+    {
+        printf("\"cycles_per_byte\": %.4f }", (double)res->cycles / (double)res->bytes);
+    }
+    else
+    {
+        printf("\"cycles_per_byte\": null }");
+    }
+    ecu_bench_printed = 1;
+
+    /* progress of a long sweep is visible in a pipe */
+    fflush(stdout);
+}
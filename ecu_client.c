@@ -0,0 +1,315 @@
+/*****************************************************************************
+**
+**  Name:           ecu_client.c
+**
+**  Description:    client of encryptUtil daemon.
+**                  sends header, key and input over a Unix socket
+**                  and receives output of the same length
+**
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ecu_client.h"
+#include "ecu_io.h"
+#include "ecu_dist.h"
+
+
+/* input side of a stream, run by sender thread */
+struct ecu_client_send
+{
+    int in_fd;
+    int sock;
+    unsigned long long sent;
+    int result;
+};
+
+
+/* static function definitions */
+static int ecu_client_connect(const char *path);
+static int ecu_client_send_all(int sock, const unsigned char *data, size_t len);
+static void *ecu_client_send_thread(void *ptr);
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_client_process_fd
+ **
+ ** Description     encrypt input fd into output fd through daemon.
+ **                 input is sent from a thread while output is received
+ **
+ ** Parameters      path : Unix socket of daemon
+ **                 key : key data
+ **                 key_size : size of key
+ **                 in_fd : input
+ **                 out_fd : output
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_client_process_fd(const char *path, const unsigned char *key, size_t key_size,
+                          int in_fd, int out_fd)
+{
+    struct ecu_serve_hdr hdr;
+    struct ecu_client_send send;
+    pthread_t tid;
+    unsigned char *buf;
+    unsigned long long rcvd = 0;
+    uint32_t status;
+    ssize_t len;
+    int sock;
+    int result = 0;
+
+    if( (path == NULL) || (key == NULL) || (key_size == 0) || (key_size > UINT32_MAX) )
+    {
+        return -1;
+    }
+
+    buf = malloc(ECU_DIST_READ_SIZE);
+    if( buf == NULL )
+    {
+        fprintf(stderr, "client buffer alloc error!\n");
+        return -1;
+    }
+
+    sock = ecu_client_connect(path);
+    if( sock < 0 )
+    {
+        free(buf);
+        return -1;
+    }
+
+    /* busy daemon replies and closes without reading header,
+     * so status is read even if header could not be sent
+     */
+    hdr.magic = ECU_SERVE_MAGIC;
+    hdr.key_size = (uint32_t)key_size;
+    result = ecu_client_send_all(sock, (const unsigned char *)&hdr, sizeof(hdr));
+    if( result == 0 )
+    {
+        result = ecu_client_send_all(sock, key, key_size);
+    }
+    if( ecu_io_read(sock, (unsigned char *)&status, sizeof(status)) != sizeof(status) )
+    {
+        status = ECU_SERVE_OK;
+        result = -1;
+    }
+    if( status != ECU_SERVE_OK )
+    {
+        fprintf(stderr, "daemon refused stream, status %u\n", status);
+        close(sock);
+        free(buf);
+        return -1;
+    }
+    if( result )
+    {
+        fprintf(stderr, "daemon closed stream %s\n", path);
+        close(sock);
+        free(buf);
+        return -1;
+    }
+
+    /* daemon reads input while client reads output, both directions
+     * must move at once or the socket buffers fill up
+     */
+    send.in_fd = in_fd;
+    send.sock = sock;
+    send.sent = 0;
+    send.result = 0;
+    if( pthread_create(&tid, NULL, ecu_client_send_thread, &send) )
+    {
+        fprintf(stderr, "cannot create client thread\n");
+        close(sock);
+        free(buf);
+        return -1;
+    }
+
+    while( 1 )
+    {
+        len = read(sock, buf, ECU_DIST_READ_SIZE);
+        if( len < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            fprintf(stderr, "read error %d\n", errno);
+            result = -1;
+            break;
+        }
+        if( len == 0 )
+        {
+            break;
+        }
+        if( ecu_io_write(out_fd, buf, (unsigned int)len) )
+        {
+            fprintf(stderr, "write error %d\n", errno);
+            result = -1;
+            break;
+        }
+        rcvd += (unsigned long long)len;
+    }
+
+    /* stop sender blocked on a stream nobody reads */
+    if( result )
+    {
+        shutdown(sock, SHUT_RDWR);
+    }
+    pthread_join(tid, NULL);
+    close(sock);
+    free(buf);
+
+    if( (result == 0) && (send.result == 0) && (rcvd != send.sent) )
+    {
+        fprintf(stderr, "stream failed in daemon, %llu of %llu bytes\n", rcvd, send.sent);
+        result = -1;
+    }
+
+    return (result || send.result) ? -1 : 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_client_connect
+ **
+ ** Description     connect to Unix socket of daemon
+ **
+ ** Parameters      path : Unix socket
+ **
+ ** Returns         socket
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_client_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    int sock;
+
+    if( strlen(path) >= sizeof(addr.sun_path) )
+    {
+        fprintf(stderr, "socket path too long %s\n", path);
+        return -1;
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if( sock < 0 )
+    {
+        fprintf(stderr, "socket error %d\n", errno);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if( connect(sock, (struct sockaddr *)&addr, sizeof(addr)) )
+    {
+        fprintf(stderr, "cannot connect to daemon %s, error %d\n", path, errno);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_client_send_all
+ **
+ ** Description     send whole data to daemon.
+ **                 closed stream is an error, not SIGPIPE of the process
+ **
+ ** Parameters      sock : socket
+ **                 data : data to send
+ **                 len : length of data
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_client_send_all(int sock, const unsigned char *data, size_t len)
+{
+    ssize_t result;
+
+    while( len > 0 )
+    {
+        result = send(sock, data, len, MSG_NOSIGNAL);
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += result;
+        len -= (size_t)result;
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_client_send_thread
+ **
+ ** Description     send input to daemon until end of input,
+ **                 then close sending side so daemon sees end of stream
+ **
+ ** Parameters      ptr : struct ecu_client_send
+ **
+ ** Returns         NULL
+ **
+ *******************************************************************************/
+static void *ecu_client_send_thread(void *ptr)
+{
+    struct ecu_client_send *send = ptr;
+    unsigned char *buf;
+    int len;
+
+    buf = malloc(ECU_DIST_READ_SIZE);
+    if( buf == NULL )
+    {
+        fprintf(stderr, "client buffer alloc error!\n");
+        send->result = -1;
+        shutdown(send->sock, SHUT_WR);
+        return NULL;
+    }
+
+    while( 1 )
+    {
+        len = ecu_io_read(send->in_fd, buf, ECU_DIST_READ_SIZE);
+        if( len < 0 )
+        {
+            fprintf(stderr, "read error %d\n", errno);
+            send->result = -1;
+            break;
+        }
+        if( len == 0 )
+        {
+            break;
+        }
+        if( ecu_client_send_all(send->sock, buf, (size_t)len) )
+        {
+            fprintf(stderr, "daemon closed stream, error %d\n", errno);
+            send->result = -1;
+            break;
+        }
+        send->sent += (unsigned long long)len;
+    }
+
+    shutdown(send->sock, SHUT_WR);
+    free(buf);
+    return NULL;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+**
+**  Name:           ecu_client.h
+**
+**  Description:    client of encryptUtil daemon (encryptUtil --serve).
+**                  a stream is sent over a Unix socket and encrypted
+**                  by warm contexts of the daemon, without fork/exec.
+**
+**                  client                          daemon
+**                  header, key     ------>
+**                                  <------         status
+**                  input data      ------>
+**                  shutdown(SHUT_WR)
+**                                  <------         output data
+**                                                  close
+**
+**                  output has the length of input, a shorter output
+**                  means the stream failed in the daemon.
+**
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#ifndef ECU_CLIENT_H
+#define ECU_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* "ECU1", first word of stream header */
+#define ECU_SERVE_MAGIC 0x31554345
+
+/* status of stream header */
+#define ECU_SERVE_OK    0
+#define ECU_SERVE_ERROR 1   /* bad header or key, context not created */
+#define ECU_SERVE_BUSY  2   /* too many streams in daemon */
+
+/* stream header, native byte order of the host. key follows it */
+struct ecu_serve_hdr
+{
+    uint32_t magic;
+    uint32_t key_size;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_client_process_fd
+ **
+ ** Description     encrypt input fd into output fd through daemon.
+ **                 input is sent from a thread while output is received
+ **
+ ** Parameters      path : Unix socket of daemon
+ **                 key : key data
+ **                 key_size : size of key
+ **                 in_fd : input
+ **                 out_fd : output
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_client_process_fd(const char *path, const unsigned char *key, size_t key_size,
+                          int in_fd, int out_fd);
+
+#endif
@@ -0,0 +1,169 @@
+/*****************************************************************************
+**
+**  Name:           ecu_cpu.c
+**
+**  Description:    CPU detection and thread affinity.
+**                  pinned threads keep their caches and do not migrate.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "ecu_cpu.h"
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_count
+ **
+ ** Description     get number of CPUs this process may run on
+ **
+ ** Parameters      none
+ **
+ ** Returns         number of CPUs, at least 1
+ **
+ *******************************************************************************/
+unsigned int ecu_cpu_count()
+{
+    cpu_set_t set;
+    int cnt;
+
+    if( sched_getaffinity(0, sizeof(set), &set) )
+    {
+        return 1;
+    }
+    cnt = CPU_COUNT(&set);
+
+    return (cnt > 0) ? (unsigned int)cnt : 1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_set_list
+ **
+ ** Description     set affinity list from "0-3,8,10-11" or "auto".
+ **                 auto is every CPU this process may run on
+ **
+ ** Parameters      list : affinity list
+ **                 str : CPU list
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_cpu_set_list(struct ecu_cpu_list *list, const char *str)
+{
+    cpu_set_t set;
+    unsigned long first, last, cpu;
+    char *end;
+
+    list->cnt = 0;
+
+    if( strcmp(str, "auto") == 0 )
+    {
+        if( sched_getaffinity(0, sizeof(set), &set) )
+        {
+            return -1;
+        }
+        for( cpu = 0 ; cpu < CPU_SETSIZE ; cpu++ )
+        {
+            if( CPU_ISSET(cpu, &set) && (list->cnt < ECU_CPU_MAX_NUM) )
+            {
+                list->cpu[list->cnt++] = cpu;
+            }
+        }
+        return (list->cnt > 0) ? 0 : -1;
+    }
+
+    while( *str )
+    {
+        /* one CPU or range of CPUs */
+        if( (*str < '0') || (*str > '9') )
+        {
+            break;
+        }
+        first = strtoul(str, &end, 10);
+        last = first;
+        if( *end == '-' )
+        {
+            str = end + 1;
+            if( (*str < '0') || (*str > '9') )
+            {
+                break;
+            }
+            last = strtoul(str, &end, 10);
+        }
+        if( (last < first) || (last >= CPU_SETSIZE) )
+        {
+            break;
+        }
+        for( cpu = first ; (cpu <= last) && (list->cnt < ECU_CPU_MAX_NUM) ; cpu++ )
+        {
+            list->cpu[list->cnt++] = cpu;
+        }
+
+        str = end;
+        if( *str == ',' )
+        {
+            str++;
+            continue;
+        }
+        if( *str == '\0' )
+        {
+            return 0;
+        }
+        break;
+    }
+
+    list->cnt = 0;
+    return -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_pin
+ **
+ ** Description     pin a thread to CPU of its slot in affinity list.
+ **                 slots wrap around a short list.
+ **                 nothing is done without affinity list
+ **
+ ** Parameters      list : affinity list
+ **                 tid : thread
+ **                 slot : ECU_CPU_xxx
+ **
+ ** Returns         0 is success
+ **                 the others are errors
+ **
+ *******************************************************************************/
+int ecu_cpu_pin(const struct ecu_cpu_list *list, pthread_t tid, unsigned int slot)
+{
+    cpu_set_t set;
+    unsigned int cpu;
+    int result;
+
+    if( list->cnt == 0 )
+    {
+        return 0;
+    }
+
+    cpu = list->cpu[slot % list->cnt];
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    result = pthread_setaffinity_np(tid, sizeof(set), &set);
+    if( result )
+    {
+        fprintf(stderr, "cannot pin thread to cpu %u, error %d\n", cpu, result);
+    }
+#ifdef DEBUG
+    printf("slot %u pinned to cpu %u\n", slot, cpu);
+#endif
+    return result;
+}
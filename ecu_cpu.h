@@ -0,0 +1,73 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_CPU_H
+#define ECU_CPU_H
+
+#include <pthread.h>
+
+/* Maximum CPUs in affinity list */
+#define ECU_CPU_MAX_NUM 1024
+
+/* thread slot in affinity list.
+ * distributor, merger, then encryptors take CPUs of the list in order
+ */
+#define ECU_CPU_DIST        0
+#define ECU_CPU_MERGER      1
+#define ECU_CPU_ENC(i)      (2 + (i))
+
+/* affinity list, empty is no pinning */
+struct ecu_cpu_list
+{
+    unsigned int cpu[ECU_CPU_MAX_NUM];
+    unsigned int cnt;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_count
+ **
+ ** Description     get number of CPUs this process may run on
+ **
+ ** Parameters      none
+ **
+ ** Returns         number of CPUs, at least 1
+ **
+ *******************************************************************************/
+unsigned int ecu_cpu_count();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_set_list
+ **
+ ** Description     set affinity list from "0-3,8,10-11" or "auto".
+ **                 auto is every CPU this process may run on
+ **
+ ** Parameters      list : affinity list
+ **                 str : CPU list
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_cpu_set_list(struct ecu_cpu_list *list, const char *str);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_cpu_pin
+ **
+ ** Description     pin a thread to CPU of its slot in affinity list.
+ **                 slots wrap around a short list.
+ **                 nothing is done without affinity list
+ **
+ ** Parameters      list : affinity list
+ **                 tid : thread
+ **                 slot : ECU_CPU_xxx
+ **
+ ** Returns         0 is success
+ **                 the others are errors
+ **
+ *******************************************************************************/
+int ecu_cpu_pin(const struct ecu_cpu_list *list, pthread_t tid, unsigned int slot);
+
+#endif
@@ -0,0 +1,284 @@
+/*****************************************************************************
+**
+**  Name:           ecu_ctx.h
+**
+**  Description:    context of one stream, internal to libecu.
+**                  every thread of a stream gets its context,
+**                  nothing is shared between contexts
+**
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#ifndef ECU_CTX_H
+#define ECU_CTX_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "ecu.h"
+#include "ecu_pool.h"
+#include "ecu_cpu.h"
+#include "ecu_dist.h"
+#include "ecu_enc.h"
+#include "ecu_merger.h"
+#include "ecu_worker.h"
+
+/* Maximum encryption key size(byte) */
+#define ECU_KEY_MAX (16*1024*1024)
+
+/* Default and maximum data block size(byte).
+ * block size is a multiple of key rotation period, key size x 8,
+ * unless the period is longer than ECU_BLOCK_DEFAULT_SIZE
+ */
+#define ECU_BLOCK_DEFAULT_SIZE (64*1024)
+#define ECU_BLOCK_MAX_SIZE (16*1024*1024)
+
+
+/* Control block for Encryption utility */
+struct encrypt_util_cb {
+    atomic_ullong instr_length; /* total input size of current run */
+    unsigned int key_size;
+    unsigned int block_size;
+    unsigned int num_of_enc_thread;
+    unsigned int read_size;     /* size of one read() from input stream */
+    unsigned int flush_size;    /* size of output flushed at once */
+    unsigned int wait_mode;     /* wait strategy of threads, ECU_WAIT_xxx */
+    unsigned int zero_copy;     /* 1 : read input directly into blocks */
+    unsigned int io_engine;     /* I/O engine of input/output fd, ECU_IO_xxx */
+    unsigned int dispatch;      /* block dispatch, ECU_ENC_DISPATCH_xxx */
+    unsigned char *key;         /* key_size bytes */
+    unsigned int key_period;    /* key rotation restarts every this bytes */
+    unsigned char *keystream;   /* XOR keystream, read only */
+    unsigned int keystream_len; /* block size, or period + block size
+                                 * if block is not a multiple of period */
+};
+
+/* context of one stream */
+struct ecu_ctx {
+    struct encrypt_util_cb cb;
+    struct ecu_pool pool;       /* data blocks handed through pipeline */
+    struct ecu_cpu_list cpus;   /* affinity list of threads */
+    struct ecu_dist dist;
+    struct ecu_enc enc;
+    struct ecu_merger merger;
+    struct ecu_workers workers; /* threads parked between runs */
+
+    /* current run */
+    int in_fd;                  /* input stream, -1 is memory input */
+    const unsigned char *in_data; /* memory input */
+    size_t in_size;
+    int out_fd;                 /* output stream, -1 is memory output */
+    unsigned char *out_data;    /* memory output, in_size bytes */
+    unsigned int out_positional; /* 1 : blocks are written at their offsets */
+    unsigned long long out_base; /* offset of output fd at start of run */
+    const char *const *batch_in;  /* input files of batch */
+    const char *const *batch_out; /* output files of batch */
+    unsigned int batch_cnt;     /* number of files, 0 is not a batch */
+    int failed;                 /* 1 if a run failed, context is unusable */
+};
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_key_size
+ **
+ ** Description     Get XOR cryptographic key value
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of key
+ **
+ *******************************************************************************/
+unsigned int ecu_get_key_size(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_block_size
+ **
+ ** Description     Get size of data block for encryptor.
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of block
+ **
+ *******************************************************************************/
+unsigned int ecu_get_block_size(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_read_size
+ **
+ ** Description     Get size of one read() from input stream
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         read size (byte)
+ **
+ *******************************************************************************/
+unsigned int ecu_get_read_size(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_flush_size
+ **
+ ** Description     Get size of output to be flushed at once
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         flush size (byte)
+ **
+ *******************************************************************************/
+unsigned int ecu_get_flush_size(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_wait_mode
+ **
+ ** Description     Get wait strategy of pipeline threads
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_WAIT_SPIN, ECU_WAIT_HYBRID or ECU_WAIT_BLOCK
+ **
+ *******************************************************************************/
+unsigned int ecu_get_wait_mode(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_zero_copy
+ **
+ ** Description     Get whether input is read directly into pipeline blocks
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is zero-copy read
+ **                 0 is chunked read
+ **
+ *******************************************************************************/
+unsigned int ecu_get_zero_copy(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_io_engine
+ **
+ ** Description     Get I/O engine of input and output fd
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_IO_xxx
+ **
+ *******************************************************************************/
+unsigned int ecu_get_io_engine(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_dispatch
+ **
+ ** Description     Get dispatch of blocks to encryptors
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_ENC_DISPATCH_xxx
+ **
+ *******************************************************************************/
+unsigned int ecu_get_dispatch(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_keystream
+ **
+ ** Description     Get keystream of a block.
+ **                 keystream is built once by ecu_create and shared by all
+ **                 encryptors. block starts at its offset in key period
+ **
+ ** Parameters      ctx : context
+ **                 offset : offset of block in input data
+ **
+ ** Returns         pointer to keystream (block size bytes)
+ **
+ *******************************************************************************/
+const unsigned char *ecu_get_keystream(struct ecu_ctx *ctx, size_t offset);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_set_instr_length
+ **
+ ** Description     Set total size of input data
+ **
+ ** Parameters      ctx : context
+ **                 len : size of input data
+ **
+ ** Returns         0 is success
+ **
+ *******************************************************************************/
+unsigned int ecu_set_instr_length(struct ecu_ctx *ctx, unsigned long long len);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_instr_length
+ **
+ ** Description     Get total size of input data
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of input data
+ **
+ *******************************************************************************/
+unsigned long long ecu_get_instr_length(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_num_of_enc_thread
+ **
+ ** Description     Get number of threads for encryption
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         number of thread
+ **
+ *******************************************************************************/
+unsigned int ecu_get_num_of_enc_thread(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_has_merger
+ **
+ ** Description     check current run writes output through merger.
+ **                 positional and memory output take blocks by offset
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is output through merger
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_has_merger(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_has_dist
+ **
+ ** Description     check current run reads input through distributor.
+ **                 memory input is taken by encryptors by offset
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is input through distributor
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_has_dist(struct ecu_ctx *ctx);
+
+#endif
@@ -0,0 +1,189 @@
+/*****************************************************************************
+**
+**  Name:           ecu_deque.c
+**
+**  Description:    bounded Chase-Lev work stealing deque.
+**                  owner works at bottom without contention,
+**                  idle threads steal at top.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ecu_deque.h"
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_init
+ **
+ ** Description     init work stealing deque
+ **
+ ** Parameters      dq : deque
+ **                 size : number of slots, must be power of 2
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_deque_init(struct ecu_deque *dq, unsigned int size)
+{
+    unsigned int i;
+
+    if( (size < 2) || (size & (size - 1)) )
+    {
+        fprintf(stderr, "deque size should be power of 2 : %u\n", size);
+        return -1;
+    }
+
+    dq->buf = malloc(sizeof(dq->buf[0]) * size);
+    if( dq->buf == NULL )
+    {
+        return -1;
+    }
+    for( i = 0 ; i < size ; i++ )
+    {
+        atomic_init(&dq->buf[i], NULL);
+    }
+
+    dq->mask = size - 1;
+    atomic_init(&dq->top, 0);
+    atomic_init(&dq->bottom, 0);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_destroy
+ **
+ ** Description     release slots of deque
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_deque_destroy(struct ecu_deque *dq)
+{
+    free(dq->buf);
+    dq->buf = NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_push
+ **
+ ** Description     push one pointer at bottom. owner only
+ **
+ ** Parameters      dq : deque
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is deque full
+ **
+ *******************************************************************************/
+int ecu_deque_push(struct ecu_deque *dq, void *data)
+{
+    long b, t;
+
+    b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    if( (unsigned long)(b - t) > dq->mask )
+    {
+        return -1;
+    }
+
+    atomic_store_explicit(&dq->buf[b & dq->mask], data, memory_order_relaxed);
+    /* thief must see data before new bottom */
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_take
+ **
+ ** Description     take one pointer at bottom. owner only
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         pointer
+ **                 NULL if deque is empty or last one was stolen
+ **
+ *******************************************************************************/
+void *ecu_deque_take(struct ecu_deque *dq)
+{
+    long b, t;
+    void *data;
+
+    /* reserve bottom slot before looking at thieves */
+    b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+    if( t > b )
+    {
+        /* empty */
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    data = atomic_load_explicit(&dq->buf[b & dq->mask], memory_order_relaxed);
+    if( t == b )
+    {
+        /* last one, race with thieves */
+        if( !atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed) )
+        {
+            data = NULL;
+        }
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return data;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_steal
+ **
+ ** Description     steal one pointer at top. any thread
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         pointer
+ **                 NULL if deque is empty or other thread won the race
+ **
+ *******************************************************************************/
+void *ecu_deque_steal(struct ecu_deque *dq)
+{
+    long b, t;
+    void *data;
+
+    t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+
+    if( t >= b )
+    {
+        return NULL;
+    }
+
+    data = atomic_load_explicit(&dq->buf[t & dq->mask], memory_order_relaxed);
+    if( !atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed) )
+    {
+        return NULL;
+    }
+
+    return data;
+}
@@ -0,0 +1,95 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_DEQUE_H
+#define ECU_DEQUE_H
+
+#include <stdatomic.h>
+
+#include "ecu_ring.h"
+
+/* bounded Chase-Lev work stealing deque of pointers.
+ * owner pushes and takes at bottom, other threads steal at top
+ */
+struct ecu_deque
+{
+    _Alignas(ECU_RING_CACHE_LINE) atomic_long top;     /* thieves */
+    _Alignas(ECU_RING_CACHE_LINE) atomic_long bottom;  /* owner */
+    _Alignas(ECU_RING_CACHE_LINE) unsigned long mask;
+    _Atomic(void *) *buf;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_init
+ **
+ ** Description     init work stealing deque
+ **
+ ** Parameters      dq : deque
+ **                 size : number of slots, must be power of 2
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_deque_init(struct ecu_deque *dq, unsigned int size);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_destroy
+ **
+ ** Description     release slots of deque
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_deque_destroy(struct ecu_deque *dq);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_push
+ **
+ ** Description     push one pointer at bottom. owner only
+ **
+ ** Parameters      dq : deque
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is deque full
+ **
+ *******************************************************************************/
+int ecu_deque_push(struct ecu_deque *dq, void *data);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_take
+ **
+ ** Description     take one pointer at bottom. owner only
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         pointer
+ **                 NULL if deque is empty or last one was stolen
+ **
+ *******************************************************************************/
+void *ecu_deque_take(struct ecu_deque *dq);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_deque_steal
+ **
+ ** Description     steal one pointer at top. any thread
+ **
+ ** Parameters      dq : deque
+ **
+ ** Returns         pointer
+ **                 NULL if deque is empty or other thread won the race
+ **
+ *******************************************************************************/
+void *ecu_deque_steal(struct ecu_deque *dq);
+
+#endif
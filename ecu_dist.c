@@ -10,31 +10,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 
-#include "ecu_main.h"
+#include "ecu_ctx.h"
 #include "ecu_dist.h"
 
 #include "ecu_enc.h"
 #include "ecu_merger.h"
-
-static pthread_t ecu_dist_tid;
-
-/* Ring Buffer between distributor and encryptor */
-struct ecu_dist_msg ECU_DIST_RB[ECU_DIST_MAX_QUEUE_NUM];
-
-/* IPC synchronization method for ECU_DIST_RB */
-struct ecu_dist_queue_ipc ECU_DIST_RB_IPC;
-
-/* write and read buffer pointer for ECU_DIST_RB ring buffer */
-unsigned int ECU_DIST_RB_wptr = 0;
-unsigned int ECU_DIST_RB_rptr = 0;
-
-
+#include "ecu_ring.h"
+#include "ecu_pool.h"
+#include "ecu_io.h"
+#include "ecu_uring.h"
+#include "ecu_cpu.h"
 
 /* static function definitions */
-static unsigned int ecu_dist_get_avail_buf_cnt_in_rb();
-static int ecu_dist_send_block(char* data, unsigned int len);
+static unsigned long long ecu_dist_read_fd(struct ecu_ctx *ctx);
+static unsigned long long ecu_dist_read_batch(struct ecu_ctx *ctx);
+static unsigned long long ecu_dist_read_chunk(struct ecu_ctx *ctx);
+static unsigned long long ecu_dist_read_direct(struct ecu_ctx *ctx);
+static unsigned long long ecu_dist_read_uring(struct ecu_ctx *ctx, struct ecu_uring *ring);
+static void ecu_dist_push_block(struct ecu_ctx *ctx, unsigned char* data, unsigned int len);
+static void ecu_dist_send_block(struct ecu_ctx *ctx, struct ecu_block *blk);
+static void ecu_dist_dispatch(struct ecu_ctx *ctx, struct ecu_block *blk);
 
 
 
@@ -44,79 +45,234 @@ static int ecu_dist_send_block(char* data, unsigned int len);
  **
  ** Description     Distributor thread function
  **                 Read data from input stream and segment data as block size
- **                 and send each block to ECU_DIST_RB
+ **                 and send each block to DIST ring buffer
  **
- ** Parameters
+ ** Parameters      ptr : context
  **
  ** Returns         void
  **
  *******************************************************************************/
 void *ecu_dist_thread(void *ptr)
 {
-    char buf[1];
-    unsigned int t_length, i;
-    unsigned int block_size;
-    unsigned char buffer[1000];
-    static int read_err = 0;
-    int result = 0;
-    int sent = 0;
-    int avail_buf_count;
+    struct ecu_ctx *ctx = ptr;
+    unsigned long long t_length;
 
 #ifdef DEBUG
     printf("ecu_dist_thread started! \n");
 #endif
 
+    if( ctx->batch_cnt )
+    {
+        t_length = ecu_dist_read_batch(ctx);
+    }
+    else
+    {
+        t_length = ecu_dist_read_fd(ctx);
+    }
+
+    /* configure total length of input stream */
+    ecu_set_instr_length(ctx, t_length);
+
+    /* every block is sent, let encryptors finish */
+    ecu_dist_send_eos(ctx);
+
+#ifdef DEBUG
+    printf("input size is %llu\n", t_length);
+#endif
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_read_fd
+ **
+ ** Description     Read input fd until end of stream with I/O engine
+ **                 of context
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         total length of input stream
+ **
+ *******************************************************************************/
+static unsigned long long ecu_dist_read_fd(struct ecu_ctx *ctx)
+{
+    struct ecu_uring ring;
+    unsigned long long t_length;
+
+    /* pipe has no zero-copy read to user memory. splice engine
+     * enlarges input pipe and reads it straight into blocks
+     */
+    if( (ecu_get_io_engine(ctx) == ECU_IO_URING) && ecu_io_is_file(ctx->in_fd, 0) &&
+        (ecu_uring_init(&ring, ECU_URING_DEPTH) == 0) )
+    {
+        /* io_uring keeps reads of file ahead of distributor */
+        t_length = ecu_dist_read_uring(ctx, &ring);
+        ecu_uring_exit(&ring);
+    }
+    else if( ecu_get_zero_copy(ctx) ||
+        ((ecu_get_io_engine(ctx) == ECU_IO_SPLICE) &&
+         ecu_io_pipe_grow(ctx->in_fd, ecu_get_read_size(ctx))) )
+    {
+        t_length = ecu_dist_read_direct(ctx);
+    }
+    else
+    {
+        t_length = ecu_dist_read_chunk(ctx);
+    }
+
+    return t_length;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_read_batch
+ **
+ ** Description     Read every input file of batch in order.
+ **                 blocks of a file never hold data of another file, next
+ **                 file is read while encryptors work on the last blocks.
+ **                 empty file is sent as an empty block, so merger
+ **                 creates its output
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         total length of every input file
+ **
+ *******************************************************************************/
+static unsigned long long ecu_dist_read_batch(struct ecu_ctx *ctx)
+{
+    struct ecu_block *blk;
+    unsigned long long t_length = 0;
+    unsigned long long len;
+    unsigned int i;
+    int fd;
+
+    for( i = 0 ; i < ctx->batch_cnt ; i++ )
+    {
+        fd = open(ctx->batch_in[i], O_RDONLY);
+        if( fd < 0 )
+        {
+            fprintf(stderr, "cannot open input file %s\n", ctx->batch_in[i]);
+            ctx->dist.result = -1;
+            break;
+        }
+
+        ctx->in_fd = fd;
+        ctx->dist.file_id = i;
+        ctx->dist.offset = 0;
+        len = ecu_dist_read_fd(ctx);
+        close(fd);
+        ctx->in_fd = -1;
+        if( ctx->dist.result )
+        {
+            break;
+        }
+
+        if( len == 0 )
+        {
+            blk = ecu_pool_get(&ctx->pool);
+            blk->data_len = 0;
+            ecu_dist_send_block(ctx, blk);
+        }
+        t_length += len;
+    }
+
+    return t_length;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_read_chunk
+ **
+ ** Description     Read input stream in chunks of read size
+ **                 and copy each block of chunk to a pool block
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         total length of input stream
+ **
+ *******************************************************************************/
+static unsigned long long ecu_dist_read_chunk(struct ecu_ctx *ctx)
+{
+    unsigned char *chunk;
+    unsigned char *buffer;
+    unsigned long long t_length;
+    unsigned int i;
+    unsigned int block_size;
+    unsigned int read_size;
+    unsigned int pos, copy_len;
+    ssize_t len;
+
     /* get block size, key_size x 8 */
-    block_size = ecu_get_block_size();
+    block_size = ecu_get_block_size(ctx);
+    read_size = ecu_get_read_size(ctx);
+
+    chunk = malloc(read_size);
+    buffer = malloc(block_size);
+    if( (chunk == NULL) || (buffer == NULL) )
+    {
+        fprintf(stderr, "dist buffer alloc error!\n");
+        free(chunk);
+        free(buffer);
+        ctx->dist.result = -1;
+        return 0;
+    }
 
     i = 0;
     t_length = 0;
 
     while(1)
     {
-        /* read input string from STDIO */
-        if(read(STDIN_FILENO, buf, 1) > 0)
+        /* read a chunk of input stream.
+         * pipe may return less than read_size, 0 means end of stream
+         */
+        len = read(ctx->in_fd, chunk, read_size);
+        if( len == 0 )
         {
-            read_err = 0;
-            buffer[i] = buf[0];
-            if( i == ( block_size - 1 ) )
-            {
-                sent = 0;
-                while(!sent)
-                {
-                    pthread_mutex_lock(&ECU_DIST_RB_IPC.lock);
-                    /* get available buffer count of DIST ring buffer */
-                    avail_buf_count = ecu_dist_get_avail_buf_cnt_in_rb();
-                    if (avail_buf_count > 3)
-                    {
-                        /* send one block to dist queue */
-                        result = ecu_dist_send_block(buffer, block_size);
-                        sent = 1;
-                    }
-                    pthread_mutex_unlock(&ECU_DIST_RB_IPC.lock);
-                    if ( result < 0 )
-                    {
-                        printf("Critical error! cannot be happened!");
-                        exit(1);
-                    }
-                }
-                i = 0;
-            }
-            else
+            break;
+        }
+        if( len < 0 )
+        {
+            if( errno == EINTR )
             {
-                i++;
+                continue;
             }
-            t_length++;
+            fprintf(stderr, "read error %d\n", errno);
+            ctx->dist.result = -1;
+            break;
         }
-        else
+
+        /* carve chunk into blocks */
+        pos = 0;
+        while( pos < (unsigned int)len )
         {
-            read_err++;
-            /* if read() returns error 5 continuous time, stop read */
-            if (read_err > 5)
+            if( ( i == 0 ) && ( (unsigned int)len - pos >= block_size ) )
             {
-                break;
+                /* whole block in chunk, send it directly */
+                ecu_dist_push_block(ctx, &chunk[pos], block_size);
+                pos += block_size;
+                continue;
+            }
+
+            /* fill partial block */
+            copy_len = block_size - i;
+            if( copy_len > (unsigned int)len - pos )
+            {
+                copy_len = (unsigned int)len - pos;
+            }
+            memcpy(&buffer[i], &chunk[pos], copy_len);
+            i += copy_len;
+            pos += copy_len;
+
+            if( i == block_size )
+            {
+                ecu_dist_push_block(ctx, buffer, block_size);
+                i = 0;
             }
         }
+        t_length += (unsigned long long)len;
     }
 
     /* input stream size should be multiple of block size.
@@ -125,52 +281,283 @@ void *ecu_dist_thread(void *ptr)
      */
     if( i )
     {
-        sent = 0;
-        while(!sent)
+        ecu_dist_push_block(ctx, buffer, i);
+    }
+
+    free(chunk);
+    free(buffer);
+
+    return t_length;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_read_direct
+ **
+ ** Description     Read input stream directly into pool blocks with readv().
+ **                 block goes to encryptor without any copy
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         total length of input stream
+ **
+ *******************************************************************************/
+static unsigned long long ecu_dist_read_direct(struct ecu_ctx *ctx)
+{
+    struct ecu_block *blks[ECU_DIST_MAX_IOV];
+    struct iovec iov[ECU_DIST_MAX_IOV];
+    struct ecu_block *blk;
+    unsigned int blk_cnt;   /* number of blocks held by distributor */
+    unsigned int max_cnt;
+    unsigned int fill;      /* bytes already read into blks[0] */
+    unsigned int done, i;
+    unsigned int block_size;
+    unsigned long long t_length;
+    ssize_t len;
+
+    block_size = ecu_get_block_size(ctx);
+
+    /* read about read size at once */
+    max_cnt = ecu_get_read_size(ctx) / block_size;
+    if( max_cnt == 0 )
+    {
+        max_cnt = 1;
+    }
+    if( max_cnt > ECU_DIST_MAX_IOV )
+    {
+        max_cnt = ECU_DIST_MAX_IOV;
+    }
+
+    blk_cnt = 0;
+    fill = 0;
+    t_length = 0;
+
+    while(1)
+    {
+        /* wait for at least one block, then take what is free */
+        if( blk_cnt == 0 )
+        {
+            blks[blk_cnt++] = ecu_pool_get(&ctx->pool);
+        }
+        while( blk_cnt < max_cnt )
+        {
+            blk = ecu_pool_try_get(&ctx->pool);
+            if( blk == NULL )
+            {
+                break;
+            }
+            blks[blk_cnt++] = blk;
+        }
+
+        iov[0].iov_base = blks[0]->p_data + fill;
+        iov[0].iov_len = block_size - fill;
+        for( i = 1 ; i < blk_cnt ; i++ )
+        {
+            iov[i].iov_base = blks[i]->p_data;
+            iov[i].iov_len = block_size;
+        }
+
+        /* pipe may return less than requested, 0 means end of stream */
+        len = readv(ctx->in_fd, iov, blk_cnt);
+        if( len == 0 )
+        {
+            break;
+        }
+        if( len < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            fprintf(stderr, "read error %d\n", errno);
+            ctx->dist.result = -1;
+            break;
+        }
+        t_length += (unsigned long long)len;
+
+        /* send every filled block, keep partially filled one */
+        done = (fill + (unsigned int)len) / block_size;
+        fill = (fill + (unsigned int)len) % block_size;
+        for( i = 0 ; i < done ; i++ )
+        {
+            blks[i]->data_len = block_size;
+            ecu_dist_send_block(ctx, blks[i]);
+        }
+        blk_cnt -= done;
+        memmove(&blks[0], &blks[done], sizeof(blks[0]) * blk_cnt);
+    }
+
+    /* reminder of data */
+    i = 0;
+    if( fill )
+    {
+        blks[0]->data_len = fill;
+        ecu_dist_send_block(ctx, blks[0]);
+        i = 1;
+    }
+    for( ; i < blk_cnt ; i++ )
+    {
+        ecu_pool_put(&ctx->pool, blks[i]);
+    }
+
+    return t_length;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_read_uring
+ **
+ ** Description     Read regular file of input fd with io_uring.
+ **                 up to ECU_URING_DEPTH blocks are read at their offsets
+ **                 at once, into pool blocks registered as fixed buffer.
+ **                 blocks complete out of order, sequence number comes
+ **                 from offset
+ **
+ ** Parameters      ctx : context
+ **                 ring : io_uring
+ **
+ ** Returns         total length of input stream
+ **
+ *******************************************************************************/
+static unsigned long long ecu_dist_read_uring(struct ecu_ctx *ctx, struct ecu_uring *ring)
+{
+    struct ecu_block *blk;
+    struct stat st;
+    unsigned long long start, end, offset, next;
+    unsigned int block_size;
+    unsigned long long t_length;
+    unsigned int want;
+    void *user;
+    int res;
+
+    block_size = ecu_get_block_size(ctx);
+
+    /* without registered buffer, plain read is used */
+    ecu_uring_register(ring, ctx->pool.arena, ctx->pool.arena_size);
+
+    start = lseek(ctx->in_fd, 0, SEEK_CUR);
+    fstat(ctx->in_fd, &st);
+    end = ((unsigned long long)st.st_size > start) ? (unsigned long long)st.st_size : start;
+    next = start;
+    t_length = 0;
+
+    while( (next < end) || (ring->inflight > 0) )
+    {
+        /* issue reads while pool has blocks.
+         * wait for pool only with no read in flight, a read in flight
+         * may hold the block merger is waiting for
+         */
+        while( (next < end) && (ring->inflight < ECU_URING_DEPTH) )
         {
-            pthread_mutex_lock(&ECU_DIST_RB_IPC.lock);
-            avail_buf_count = ecu_dist_get_avail_buf_cnt_in_rb();
-            if (avail_buf_count > 1)
+            blk = (ring->inflight > 0) ? ecu_pool_try_get(&ctx->pool)
+                                       : ecu_pool_get(&ctx->pool);
+            if( blk == NULL )
             {
-                result = ecu_dist_send_block(buffer, i);
-                sent = 1;
+                break;
+            }
+            blk->seq_num = ctx->dist.seq_num++;
+            blk->file_id = ctx->dist.file_id;
+            blk->offset = next - start;
+            blk->data_len = 0;
+            want = (end - next < block_size) ? (unsigned int)(end - next) : block_size;
+            ecu_uring_prep(ring, 0, ctx->in_fd, blk->p_data, want, next, blk);
+            next += want;
+        }
+
+        if( ecu_uring_submit(ring, 1) )
+        {
+            /* reads in flight are lost, context is not used again */
+            ctx->dist.result = -1;
+            break;
+        }
+
+        while( ecu_uring_reap(ring, &user, &res) )
+        {
+            blk = user;
+            offset = start + blk->offset;
+            want = (end - offset < block_size) ? (unsigned int)(end - offset) : block_size;
+
+            if( ctx->dist.result )
+            {
+                /* stream is cut at read error, drain reads in flight */
+                ecu_pool_put(&ctx->pool, blk);
+                continue;
+            }
+
+            if( (res == -EINTR) || (res == -EAGAIN) )
+            {
+                res = 0;
+            }
+            else if( res < 0 )
+            {
+                fprintf(stderr, "read error %d\n", -res);
+                ctx->dist.result = -1;
+                next = end;
+                ecu_pool_put(&ctx->pool, blk);
+                continue;
+            }
+            else if( res == 0 )
+            {
+                /* file was shortened, this block is the last one */
+                want = blk->data_len;
+                end = offset + want;
+                if( next > end )
+                {
+                    next = end;
+                }
+            }
+            blk->data_len += (unsigned int)res;
+
+            if( blk->data_len < want )
+            {
+                /* short read, read the rest of block */
+                ecu_uring_prep(ring, 0, ctx->in_fd, blk->p_data + blk->data_len,
+                               want - blk->data_len, offset + blk->data_len, blk);
+            }
+            else if( blk->data_len > 0 )
+            {
+                t_length += blk->data_len;
+                ecu_dist_dispatch(ctx, blk);
+            }
+            else
+            {
+                ecu_pool_put(&ctx->pool, blk);
             }
-            pthread_mutex_unlock(&ECU_DIST_RB_IPC.lock);
         }
     }
 
-    /* configure total length of input stream */
-    ecu_set_instr_length(t_length);
+    /* leave input offset after consumed data as read() does */
+    lseek(ctx->in_fd, start + t_length, SEEK_SET);
 
-#ifdef DEBUG
-    printf("input size is %d\n", t_length);
-#endif
+    return t_length;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_dist_m_start
+ ** Function        ecu_dist_rb_start
  **
- ** Description     init Mutex for Distributor ring buffer access.
+ ** Description     init Distributor ring buffer.
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are error
  **
  *******************************************************************************/
-int ecu_dist_m_start()
+int ecu_dist_rb_start(struct ecu_ctx *ctx)
 {
     int result;
 #ifdef DEBUG
-    printf("ecu_dist_m_start\n");
+    printf("ecu_dist_rb_start\n");
 #endif
 
-    result = pthread_mutex_init(&ECU_DIST_RB_IPC.lock, NULL);
+    result = ecu_ring_init(&ctx->dist.rb, ECU_DIST_MAX_QUEUE_NUM, ecu_get_wait_mode(ctx));
     if (result != 0)
     {
-        printf("pthread_mutex_init error %d\n", result);
+        fprintf(stderr, "ecu_ring_init error %d\n", result);
     }
 
     return result;
@@ -183,29 +570,56 @@ int ecu_dist_m_start()
  **
  ** Description     Create Distributor thread.
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are error
  **
  *******************************************************************************/
-int ecu_dist_t_start()
+int ecu_dist_t_start(struct ecu_ctx *ctx)
 {
     int result;
 #ifdef DEBUG
     printf("ecu_dist_t_start\n");
 #endif
+    ctx->dist.result = 0;
+    ctx->dist.seq_num = 0;
+    ctx->dist.offset = 0;
+    ctx->dist.file_id = 0;
+
     /* create thread */
-    result = pthread_create(&ecu_dist_tid, NULL, ecu_dist_thread, NULL);
+    result = ecu_worker_create(&ctx->workers, &ctx->dist.tid, ecu_dist_thread, ctx);
     if(result)
     {
-        printf("pthread_create error!!");
+        fprintf(stderr, "pthread_create error!!\n");
+        return result;
     }
+    ecu_cpu_pin(&ctx->cpus, ctx->dist.tid, ECU_CPU_DIST);
 
     return result;
 }
 
 
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_t_join
+ **
+ ** Description     wait for distributor thread to finish input stream
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if input stream ended with error
+ **
+ *******************************************************************************/
+int ecu_dist_t_join(struct ecu_ctx *ctx)
+{
+    ecu_worker_join(&ctx->workers, ctx->dist.tid);
+
+    return ctx->dist.result;
+}
+
+
 
 /*******************************************************************************
  **
@@ -213,40 +627,23 @@ int ecu_dist_t_start()
  **
  ** Description     pop one block from DIST ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         pointer to one attained block from ring buffer
+ **                 NULL if ring buffer is empty
  **
  *******************************************************************************/
-struct ecu_dist_msg* ecu_dist_pop_block()
+struct ecu_block* ecu_dist_pop_block(struct ecu_ctx *ctx)
 {
-    struct ecu_dist_msg *msg = NULL;
+    struct ecu_block *msg;
 
-    if (ECU_DIST_RB_rptr == ECU_DIST_RB_wptr)
+    msg = ecu_ring_pop(&ctx->dist.rb);
+#ifdef DEBUG
+    if (msg)
     {
-        /* no data in circular queue */
-        printf("error! no data in DIST circular queue !!\n");
+        printf("pop seq:%llu\n", msg->seq_num);
     }
-    else
-    {
-        msg = malloc(sizeof(struct ecu_dist_msg));
-
-        msg->data_len = ECU_DIST_RB[ECU_DIST_RB_rptr].data_len;
-        msg->key_len = ECU_DIST_RB[ECU_DIST_RB_rptr].key_len;
-        msg->p_data = ECU_DIST_RB[ECU_DIST_RB_rptr].p_data;
-        msg->p_key = ECU_DIST_RB[ECU_DIST_RB_rptr].p_key;
-        msg->seq_num = ECU_DIST_RB[ECU_DIST_RB_rptr].seq_num;
-
-#ifdef DEBUG
-        printf("pop seq:%d\n", msg->seq_num);
 #endif
-        ECU_DIST_RB_rptr++;
-
-        if (ECU_DIST_RB_rptr == ECU_DIST_MAX_QUEUE_NUM)
-        {
-            ECU_DIST_RB_rptr = 0;
-        }
-    }
 
     return msg;
 }
@@ -258,25 +655,43 @@ struct ecu_dist_msg* ecu_dist_pop_block()
  **
  ** Description     Get number of block in DIST ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         number of blocks
  **
  *******************************************************************************/
-unsigned int ecu_dist_get_block_cnt_in_rb()
+unsigned int ecu_dist_get_block_cnt_in_rb(struct ecu_ctx *ctx)
 {
-    unsigned int result = 0;
+    return ecu_ring_count(&ctx->dist.rb);
+}
 
-    if(ECU_DIST_RB_wptr > ECU_DIST_RB_rptr)
-    {
-        result = ECU_DIST_RB_wptr - ECU_DIST_RB_rptr;
-    }
-    if(ECU_DIST_RB_wptr < ECU_DIST_RB_rptr)
-    {
-        result = (ECU_DIST_RB_wptr + ECU_DIST_MAX_QUEUE_NUM) - ECU_DIST_RB_rptr;
-    }
 
-    return result;
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_push_block
+ **
+ ** Description     copy one block to a pool block and send it
+ **                 to DIST ring buffer
+ **
+ ** Parameters      ctx : context
+ **                 data : pointer to a block
+ **                 len : length of a block
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_dist_push_block(struct ecu_ctx *ctx, unsigned char* data, unsigned int len)
+{
+    struct ecu_block *blk;
+
+    /* wait for a free block. pool size also keeps blocks in flight
+     * within reorder buffer of merger
+     */
+    blk = ecu_pool_get(&ctx->pool);
+    blk->data_len = len;
+    memcpy(blk->p_data, data, len);
+
+    ecu_dist_send_block(ctx, blk);
 }
 
 
@@ -284,75 +699,78 @@ unsigned int ecu_dist_get_block_cnt_in_rb()
  **
  ** Function        ecu_dist_send_block
  **
- ** Description     send one block to DIST ring buffer
+ ** Description     give sequence number, file and offset to a filled
+ **                 block and send it to DIST ring buffer.
+ **                 wait until ring buffer has room
  **
- ** Parameters      data : pointer to a block
- **                 len : length of a block
+ ** Parameters      ctx : context
+ **                 blk : filled pool block
  **
- ** Returns         0 is success
- **                 -1 is error
+ ** Returns         none
  **
  *******************************************************************************/
-static int ecu_dist_send_block(char* data, unsigned int len)
+static void ecu_dist_send_block(struct ecu_ctx *ctx, struct ecu_block *blk)
 {
-    struct ecu_dist_msg *msg;
-    static unsigned int seq_num = 0;
+    blk->seq_num = ctx->dist.seq_num++;
+    blk->file_id = ctx->dist.file_id;
+    blk->offset = ctx->dist.offset;
+    ctx->dist.offset += blk->data_len;
 
-    msg = &ECU_DIST_RB[ECU_DIST_RB_wptr];
-
-    msg->data_len = len;
-    msg->key_len = ecu_get_key_size();
-    msg->p_data = malloc(msg->data_len);
-    msg->p_key = malloc(msg->key_len);
-    msg->seq_num = seq_num++;
-    memcpy(msg->p_data, data, len);
-    ecu_copy_key(msg->p_key);
+    ecu_dist_dispatch(ctx, blk);
+}
 
-    ECU_DIST_RB_wptr++;
 
-    if (ECU_DIST_RB_wptr == ECU_DIST_MAX_QUEUE_NUM)
-    {
-        ECU_DIST_RB_wptr = 0;
-    }
-    if (ECU_DIST_RB_wptr == ECU_DIST_RB_rptr)
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_dispatch
+ **
+ ** Description     send a block to encryptors. wait until queue has room.
+ **                 round-robin dispatch sends block n to encryptor n % N
+ **
+ ** Parameters      ctx : context
+ **                 blk : block with sequence number
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_dist_dispatch(struct ecu_ctx *ctx, struct ecu_block *blk)
+{
+    if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
     {
-        /* ring buffer overflow */
-        printf("error! dist ring buffer full!!\n");
-        return -1;
+        ecu_spsc_push_wait(ecu_enc_get_in_q(ctx, blk->seq_num), blk);
+        return;
     }
-
-    return 0;
+    ecu_ring_push_wait(&ctx->dist.rb, blk);
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_dist_get_avail_buf_cnt_in_rb
+ ** Function        ecu_dist_send_eos
  **
- ** Description     Get available buffer count from DIST ring buffer
+ ** Description     send end of stream marker to every encryptor after
+ **                 last block. each encryptor takes one and stops
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
- ** Returns         number of available buffer
+ ** Returns         none
  **
  *******************************************************************************/
-static unsigned int ecu_dist_get_avail_buf_cnt_in_rb()
+void ecu_dist_send_eos(struct ecu_ctx *ctx)
 {
-    unsigned int result = 0;
+    unsigned int num, i;
 
-    /* queue is empty */
-    if(ECU_DIST_RB_wptr == ECU_DIST_RB_rptr)
-    {
-        result = ECU_DIST_MAX_QUEUE_NUM;
-    }
-    else if(ECU_DIST_RB_wptr > ECU_DIST_RB_rptr)
-    {
-        result = ECU_DIST_MAX_QUEUE_NUM - (ECU_DIST_RB_wptr - ECU_DIST_RB_rptr);
-    }
-    else if(ECU_DIST_RB_wptr < ECU_DIST_RB_rptr)
+    num = ecu_get_num_of_enc_thread(ctx);
+    for( i = 0 ; i < num ; i++ )
     {
-        result = ECU_DIST_RB_rptr - ECU_DIST_RB_wptr;
+        if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
+        {
+            /* next N sequence numbers cover every encryptor once */
+            ecu_spsc_push_wait(ecu_enc_get_in_q(ctx, ctx->dist.seq_num + i), &ECU_BLOCK_EOS);
+        }
+        else
+        {
+            ecu_ring_push_wait(&ctx->dist.rb, &ECU_BLOCK_EOS);
+        }
     }
-
-    return result;
 }
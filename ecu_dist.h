@@ -3,22 +3,30 @@
 #ifndef ECU_DIST_H
 #define ECU_DIST_H
 
-/* Maximum Distributor ring buffer size */
-#define ECU_DIST_MAX_QUEUE_NUM 100
+#include <pthread.h>
 
-/* data structure between distributor and encryptor */
-struct ecu_dist_msg
-{
-    unsigned int seq_num;  /* sequence number of block */
-    unsigned char *p_data;
-    unsigned int data_len;
-    unsigned char *p_key;
-    unsigned int key_len;
-};
+#include "ecu_ring.h"
+
+/* Default size of one read() from input stream (byte) */
+#define ECU_DIST_READ_SIZE (1024*1024)
+
+/* Maximum blocks in one readv() of zero-copy read, IOV_MAX of Linux */
+#define ECU_DIST_MAX_IOV 1024
 
-/* synchronization method for DIST ring buffer */
-struct ecu_dist_queue_ipc {
-    pthread_mutex_t   lock;
+/* Distributor ring buffer size, power of 2 */
+#define ECU_DIST_MAX_QUEUE_NUM 128
+
+struct ecu_ctx;
+
+/* distributor of a context */
+struct ecu_dist
+{
+    pthread_t tid;
+    int result;                 /* -1 if input stream ended with error */
+    struct ecu_ring rb;         /* ring buffer between distributor and encryptor */
+    unsigned long long seq_num; /* sequence number of next block */
+    unsigned long long offset;  /* offset of next block in current file */
+    unsigned int file_id;       /* current file of batch */
 };
 
 /*******************************************************************************
@@ -29,7 +37,7 @@ struct ecu_dist_queue_ipc {
  **                 Read data from input stream and segment data as block size
  **                 and send each block to ECU_DIST_RB
  **
- ** Parameters
+ ** Parameters      ptr : context
  **
  ** Returns         void
  **
@@ -39,17 +47,17 @@ void *ecu_dist_thread(void *ptr);
 
 /*******************************************************************************
  **
- ** Function        ecu_dist_m_start
+ ** Function        ecu_dist_rb_start
  **
- ** Description     init Mutex for Distributor ring buffer access.
+ ** Description     init Distributor ring buffer.
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are error
  **
  *******************************************************************************/
-int ecu_dist_m_start();
+int ecu_dist_rb_start(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -58,13 +66,28 @@ int ecu_dist_m_start();
  **
  ** Description     Create Distributor thread.
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are error
  **
  *******************************************************************************/
-int ecu_dist_t_start();
+int ecu_dist_t_start(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_t_join
+ **
+ ** Description     wait for distributor thread to finish input stream
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if input stream ended with error
+ **
+ *******************************************************************************/
+int ecu_dist_t_join(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -73,12 +96,13 @@ int ecu_dist_t_start();
  **
  ** Description     pop one block from DIST ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         pointer to one attained block from ring buffer
+ **                 NULL if ring buffer is empty
  **
  *******************************************************************************/
-struct ecu_dist_msg* ecu_dist_pop_block();
+struct ecu_block* ecu_dist_pop_block(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -87,11 +111,26 @@ struct ecu_dist_msg* ecu_dist_pop_block();
  **
  ** Description     Get number of block in DIST ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         number of blocks
  **
  *******************************************************************************/
-unsigned int ecu_dist_get_block_cnt_in_rb();
+unsigned int ecu_dist_get_block_cnt_in_rb(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_dist_send_eos
+ **
+ ** Description     send end of stream marker to every encryptor after
+ **                 last block. each encryptor takes one and stops
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_dist_send_eos(struct ecu_ctx *ctx);
 
 #endif
@@ -11,34 +11,37 @@
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
 
-#include "ecu_main.h"
+#include "ecu_ctx.h"
 #include "ecu_dist.h"
 #include "ecu_enc.h"
 #include "ecu_merger.h"
-
-/* pthread ids for N encrypt threads */
-static pthread_t ecu_enc_tid[ECU_ENC_MAX_THREAD_NUM];
-
-/* ENC ring buffer synchronization method */
-struct enc_queue_ipc ECU_ENC_RB_IPC;
-
-/* Encrytor ring buffer */
-struct ecu_enc_msg ECU_ENC_RB[ECU_ENC_MAX_QUEUE_NUM];
-
-/* read and write pointer for ENC ring buffer */
-unsigned int ECU_ENC_RB_wptr = 0;
-unsigned int ECU_ENC_RB_rptr = 0;
-
-extern struct encrypt_util_cb ENC_CB;
-extern struct ecu_dist_queue_ipc ECU_DIST_RB_IPC;
-
+#include "ecu_xor.h"
+#include "ecu_ring.h"
+#include "ecu_deque.h"
+#include "ecu_pool.h"
+#include "ecu_io.h"
+#include "ecu_cpu.h"
 
 /* static function definitions */
 static void *ecu_enc_thread(void *ptr);
-static int ecu_enc_execute(struct ecu_dist_msg *dist_msg);
-static unsigned int ecu_enc_get_avail_buf_cnt_in_rb();
-static int ecu_enc_push_block(unsigned char* data, unsigned int len, unsigned int seq);
+static void *ecu_enc_file_thread(void *ptr);
+static int ecu_enc_execute(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id);
+static void ecu_enc_output(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id);
+static struct ecu_block *ecu_enc_get_block(struct ecu_ctx *ctx, unsigned int id);
+static void ecu_enc_send_block(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id);
+static int ecu_enc_q_start(struct ecu_ctx *ctx);
+static int ecu_enc_dq_start(struct ecu_ctx *ctx);
+static struct ecu_block *ecu_enc_dq_get(struct ecu_ctx *ctx, unsigned int id);
+static struct ecu_block *ecu_enc_file_dq_get(struct ecu_ctx *ctx, unsigned int id,
+                                             unsigned long long blk_cnt);
+static void ecu_enc_dq_fill(struct ecu_ctx *ctx, unsigned int id,
+                            struct ecu_block **batch, unsigned int cnt);
+static struct ecu_block *ecu_enc_steal(struct ecu_ctx *ctx, unsigned int id);
+static void ecu_enc_send_eos(struct ecu_ctx *ctx, unsigned int id);
+static void ecu_enc_t_abort(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -48,118 +51,364 @@ static int ecu_enc_push_block(unsigned char* data, unsigned int len, unsigned in
  ** Description     encryptor thread function
  **                 do XOR encription
  **
- ** Parameters
+ ** Parameters      ptr : ecu_enc_arg of encryptor
  **
  ** Returns         void
  **
  *******************************************************************************/
 static void *ecu_enc_thread(void *ptr)
 {
-    struct ecu_dist_msg *dist_msg;
-    unsigned int q_cnt;
-    int result = 0;
+    struct ecu_enc_arg *arg = ptr;
+    struct ecu_ctx *ctx = arg->ctx;
+    struct ecu_block *blk;
+    unsigned int id;
+
+    id = arg->id;
 
     while(1)
     {
-        pthread_mutex_lock(&ECU_DIST_RB_IPC.lock);
-        q_cnt = ecu_dist_get_block_cnt_in_rb();
-        if(q_cnt > 0)
+        /* wait for a block from distributor */
+        blk = ecu_enc_get_block(ctx, id);
+        if( blk == &ECU_BLOCK_EOS )
+        {
+            break;
+        }
+        if(blk)
         {
 #ifdef DEBUG
-            printf("q_cnt:%d\n",q_cnt);
+            printf("encrypt \n");
 #endif
-            dist_msg = ecu_dist_pop_block();
-            pthread_mutex_unlock(&ECU_DIST_RB_IPC.lock);
-            if(dist_msg)
+            /* do decryption!!! */
+            ecu_enc_execute(ctx, blk, id);
+        }
+    }
+
+    /* every block of this encryptor is sent before */
+    ecu_enc_send_eos(ctx, id);
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_file_thread
+ **
+ ** Description     encryptor thread function for memory input.
+ **                 take next block of input by offset, XOR it into a
+ **                 pool block and send it to merger or positional output.
+ **                 with memory output, XOR it straight into output.
+ **                 round-robin dispatch takes every N-th block,
+ **                 work stealing dispatch takes them through deques
+ **
+ ** Parameters      ptr : ecu_enc_arg of encryptor
+ **
+ ** Returns         void
+ **
+ *******************************************************************************/
+static void *ecu_enc_file_thread(void *ptr)
+{
+    struct ecu_enc_arg *arg = ptr;
+    struct ecu_ctx *ctx = arg->ctx;
+    struct ecu_enc *enc = &ctx->enc;
+    struct ecu_block *blk;
+    const unsigned char *data;
+    unsigned char *out;
+    unsigned long long blk_cnt, idx, rr_idx;
+    unsigned int block_size, len;
+    unsigned int id;
+    size_t size, offset;
+
+    id = arg->id;
+    rr_idx = id;
+
+    data = ctx->in_data;
+    size = ctx->in_size;
+    block_size = ecu_get_block_size(ctx);
+    blk_cnt = (size + block_size - 1) / block_size;
+
+    /* memory output, XOR from input straight into output */
+    out = ctx->out_data;
+    while( out )
+    {
+        idx = atomic_fetch_add_explicit(&enc->file_next, 1, memory_order_relaxed);
+        if( (idx >= blk_cnt) || atomic_load_explicit(&enc->stop, memory_order_relaxed) )
+        {
+            return NULL;
+        }
+
+        offset = (size_t)idx * block_size;
+        len = block_size;
+        if( size - offset < block_size )
+        {
+            len = (unsigned int)(size - offset);
+        }
+        ecu_xor_block(out + offset, data + offset, ecu_get_keystream(ctx, offset), len);
+    }
+
+    while( atomic_load_explicit(&enc->stop, memory_order_relaxed) == 0 )
+    {
+        /* work stealing dispatch, block index is set in deque */
+        if( enc->dq_num )
+        {
+            blk = ecu_enc_file_dq_get(ctx, id, blk_cnt);
+            if( blk == NULL )
             {
-#ifdef DEBUG
-                printf("encrypt \n");
-#endif
-                /* do decryption!!! */
-                result = ecu_enc_execute(dist_msg);
-                if (result < 0)
-                {
-                    sleep(1);
-                }
+                break;
+            }
+            idx = blk->seq_num;
+        }
+        else
+        {
+            /* take pool block before block index. a thread waiting for pool
+             * with an index would keep merger from draining reorder buffer
+             */
+            blk = ecu_pool_get(&ctx->pool);
+
+            if( enc->q_num )
+            {
+                idx = rr_idx;
+                rr_idx += enc->q_num;
             }
             else
             {
-                printf(" critical error!!\n");
-                exit(0);
+                idx = atomic_fetch_add_explicit(&enc->file_next, 1, memory_order_relaxed);
+            }
+            if( idx >= blk_cnt )
+            {
+                ecu_pool_put(&ctx->pool, blk);
+                break;
             }
         }
-        else
+
+        offset = (size_t)idx * block_size;
+        blk->seq_num = idx;
+        blk->offset = offset;
+        blk->file_id = 0;
+        blk->data_len = block_size;
+        if( size - offset < block_size )
         {
-            pthread_mutex_unlock(&ECU_DIST_RB_IPC.lock);
+            blk->data_len = (unsigned int)(size - offset);
         }
+
+        ecu_xor_block(blk->p_data, data + offset, ecu_get_keystream(ctx, offset), blk->data_len);
+
+        ecu_enc_output(ctx, blk, id);
     }
+
+    ecu_enc_send_eos(ctx, id);
+    return NULL;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_enc_m_start
+ ** Function        ecu_enc_rb_start
  **
- ** Description     init mutex for enc ring buffer
+ ** Description     init enc ring buffer
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-int ecu_enc_m_start()
+int ecu_enc_rb_start(struct ecu_ctx *ctx)
 {
     int result;
 #ifdef DEBUG
-    printf("ecu_enc_m_start\n");
+    printf("ecu_enc_rb_start\n");
 #endif
 
-    result = pthread_mutex_init(&ECU_ENC_RB_IPC.lock, NULL);
+    result = ecu_ring_init(&ctx->enc.rb, ECU_ENC_MAX_QUEUE_NUM, ecu_get_wait_mode(ctx));
     if (result != 0)
     {
-        printf("pthread_mutex_init error %d\n", result);
+        fprintf(stderr, "ecu_ring_init error %d\n", result);
+        return result;
+    }
+
+    if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
+    {
+        result = ecu_enc_q_start(ctx);
+    }
+    else if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_STEAL )
+    {
+        result = ecu_enc_dq_start(ctx);
     }
 
     return result;
 }
 
 
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_q_start
+ **
+ ** Description     init input and output queue of every encryptor
+ **                 for round-robin dispatch.
+ **                 queue size keeps a pool block free for the encryptor
+ **                 merger is waiting for, even if every other encryptor
+ **                 has its output queue full
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_enc_q_start(struct ecu_ctx *ctx)
+{
+    struct ecu_enc *enc = &ctx->enc;
+    unsigned int num, size, limit, i;
+    unsigned int wait_mode;
+
+    num = ecu_get_num_of_enc_thread(ctx);
+    wait_mode = ecu_get_wait_mode(ctx);
+
+    /* (num - 1) x (size + 1) blocks may wait in other encryptors */
+    limit = ctx->pool.block_num / num;
+    size = ECU_ENC_RR_QUEUE_NUM;
+    while( (size > 2) && (size + 1 > limit) )
+    {
+        size >>= 1;
+    }
+
+    enc->in_q = aligned_alloc(ECU_RING_CACHE_LINE, sizeof(struct ecu_spsc) * num);
+    enc->out_q = aligned_alloc(ECU_RING_CACHE_LINE, sizeof(struct ecu_spsc) * num);
+    if( (enc->in_q == NULL) || (enc->out_q == NULL) )
+    {
+        fprintf(stderr, "encryptor queue alloc error!\n");
+        return -1;
+    }
+    memset(enc->in_q, 0, sizeof(struct ecu_spsc) * num);
+    memset(enc->out_q, 0, sizeof(struct ecu_spsc) * num);
+    enc->q_num = num;
+
+    for( i = 0 ; i < num ; i++ )
+    {
+        if( ecu_spsc_init(&enc->in_q[i], size, wait_mode) ||
+            ecu_spsc_init(&enc->out_q[i], size, wait_mode) )
+        {
+            return -1;
+        }
+    }
+
+#ifdef DEBUG
+    printf("round-robin queues %u x %u\n", num, size);
+#endif
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_dq_start
+ **
+ ** Description     init deque of every encryptor for work stealing dispatch
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_enc_dq_start(struct ecu_ctx *ctx)
+{
+    struct ecu_enc *enc = &ctx->enc;
+    unsigned int num, i;
+
+    num = ecu_get_num_of_enc_thread(ctx);
+
+    enc->dq = aligned_alloc(ECU_RING_CACHE_LINE, sizeof(struct ecu_deque) * num);
+    if( enc->dq == NULL )
+    {
+        fprintf(stderr, "encryptor deque alloc error!\n");
+        return -1;
+    }
+    memset(enc->dq, 0, sizeof(struct ecu_deque) * num);
+    enc->dq_num = num;
+
+    for( i = 0 ; i < num ; i++ )
+    {
+        if( ecu_deque_init(&enc->dq[i], ECU_ENC_STEAL_QUEUE_NUM) )
+        {
+            return -1;
+        }
+    }
+
+#ifdef DEBUG
+    printf("work stealing deques %u x %u\n", num, ECU_ENC_STEAL_QUEUE_NUM);
+#endif
+    return 0;
+}
+
+
 /*******************************************************************************
  **
  ** Function        ecu_enc_t_start
  **
- ** Description     create encryptor thread
+ ** Description     create encryptor threads. if a thread can not be
+ **                 created, started ones are stopped and merger gets end
+ **                 of stream of every encryptor
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-int ecu_enc_t_start()
+int ecu_enc_t_start(struct ecu_ctx *ctx)
 {
+    struct ecu_enc *enc = &ctx->enc;
     unsigned int num_of_thread = 0;
     unsigned int i;
-    int result;
+    int result = 0;
+    void *(*thread_fn)(void *);
 #ifdef DEBUG
     printf("ecu_enc_t_start\n");
 #endif
 
-    num_of_thread = ecu_get_num_of_enc_thread();
+    num_of_thread = ecu_get_num_of_enc_thread(ctx);
+    if( enc->tid == NULL )
+    {
+        enc->tid = malloc(sizeof(pthread_t) * num_of_thread);
+        enc->arg = malloc(sizeof(struct ecu_enc_arg) * num_of_thread);
+        if( (enc->tid == NULL) || (enc->arg == NULL) )
+        {
+            fprintf(stderr, "thread id alloc error!\n");
+            return -1;
+        }
+    }
+
+    atomic_store(&enc->file_next, 0);
+    atomic_store(&enc->result, 0);
+    atomic_store(&enc->stop, 0);
+    enc->t_num = 0;
+
+    /* memory input has no distributor */
+    thread_fn = ecu_enc_thread;
+    if( ecu_has_dist(ctx) == 0 )
+    {
+        thread_fn = ecu_enc_file_thread;
+    }
 
     for(i=0;i<num_of_thread;i++)
     {
 #ifdef DEBUG
 	    printf("ecu_enc thread %d\n", i);
 #endif
+        enc->arg[i].ctx = ctx;
+        enc->arg[i].id = i;
+
         /* create thread */
-        result = pthread_create(&ecu_enc_tid[i], NULL, ecu_enc_thread, NULL);
+        result = ecu_worker_create(&ctx->workers, &enc->tid[i], thread_fn, &enc->arg[i]);
         if(result)
         {
-            printf("pthread_create error!!");
+            fprintf(stderr, "pthread_create error!!\n");
+            ecu_enc_t_abort(ctx);
             break;
         }
+        enc->t_num++;
+        ecu_cpu_pin(&ctx->cpus, enc->tid[i], ECU_CPU_ENC(i));
     }
 
     return result;
@@ -168,46 +417,64 @@ int ecu_enc_t_start()
 
 /*******************************************************************************
  **
- ** Function        ecu_enc_pop_block
+ ** Function        ecu_enc_t_abort
  **
- ** Description     pop encrypted block from encryption buffer
+ ** Description     stop started encryptors when not every one could be
+ **                 created. each started one gets end of stream, merger
+ **                 gets end of stream in place of every missing one
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
- ** Returns         pointer to encrypt ring buffer
+ ** Returns         none
  **
  *******************************************************************************/
-struct ecu_enc_msg * ecu_enc_pop_block()
+static void ecu_enc_t_abort(struct ecu_ctx *ctx)
 {
-    struct ecu_enc_msg *msg = NULL;
+    struct ecu_enc *enc = &ctx->enc;
+    unsigned int i;
+
+    atomic_store(&enc->stop, 1);
 
-    if (ECU_ENC_RB_rptr == ECU_ENC_RB_wptr)
+    /* memory input encryptors see stop flag, the others wait for blocks */
+    for( i = 0 ; ecu_has_dist(ctx) && (i < enc->t_num) ; i++ )
     {
-        /* no data in circular queue */
-#ifdef DEBUG
-        printf("error! no data in ENC circular queue !!\n");
-#endif
+        if( enc->q_num )
+        {
+            ecu_spsc_push_wait(&enc->in_q[i], &ECU_BLOCK_EOS);
+        }
+        else
+        {
+            ecu_ring_push_wait(&ctx->dist.rb, &ECU_BLOCK_EOS);
+        }
     }
-    else
+    for( i = 0 ; i < enc->t_num ; i++ )
     {
-        msg = malloc(sizeof(struct ecu_enc_msg));
-
-        msg->data_len = ECU_ENC_RB[ECU_ENC_RB_rptr].data_len;
-        msg->p_enc_data = malloc(msg->data_len);
-        msg->seq_num = ECU_ENC_RB[ECU_ENC_RB_rptr].seq_num;
-        memcpy(msg->p_enc_data, ECU_ENC_RB[ECU_ENC_RB_rptr].p_enc_data, msg->data_len);
-
-        free(ECU_ENC_RB[ECU_ENC_RB_rptr].p_enc_data);
-
-        ECU_ENC_RB_rptr++;
+        ecu_worker_join(&ctx->workers, enc->tid[i]);
+    }
 
-        if (ECU_ENC_RB_rptr == ECU_ENC_MAX_QUEUE_NUM)
-        {
-            ECU_ENC_RB_rptr = 0;
-        }
+    for( i = enc->t_num ; i < ecu_get_num_of_enc_thread(ctx) ; i++ )
+    {
+        ecu_enc_send_eos(ctx, i);
     }
+    enc->t_num = 0;
+}
+
 
-    return msg;
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_pop_block
+ **
+ ** Description     pop encrypted block from encryption buffer
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         pointer to encrypted block
+ **                 NULL if ring buffer is empty
+ **
+ *******************************************************************************/
+struct ecu_block * ecu_enc_pop_block(struct ecu_ctx *ctx)
+{
+    return ecu_ring_pop(&ctx->enc.rb);
 }
 
 
@@ -217,25 +484,14 @@ struct ecu_enc_msg * ecu_enc_pop_block()
  **
  ** Description     get number of block in encriptor ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         number of block
  **
  *******************************************************************************/
-unsigned int ecu_enc_get_block_cnt_in_rb()
+unsigned int ecu_enc_get_block_cnt_in_rb(struct ecu_ctx *ctx)
 {
-    unsigned int result = 0;
-
-    if(ECU_ENC_RB_wptr > ECU_ENC_RB_rptr)
-    {
-        result = ECU_ENC_RB_wptr - ECU_ENC_RB_rptr;
-    }
-    if(ECU_ENC_RB_wptr < ECU_ENC_RB_rptr)
-    {
-        result = (ECU_ENC_RB_wptr + ECU_ENC_MAX_QUEUE_NUM) - ECU_ENC_RB_rptr;
-    }
-
-    return result;
+    return ecu_ring_count(&ctx->enc.rb);
 }
 
 
@@ -243,161 +499,472 @@ unsigned int ecu_enc_get_block_cnt_in_rb()
  **
  ** Function        ecu_enc_execute
  **
- ** Description     execute encryption and shift key
+ ** Description     execute encryption with block keystream in place
+ **                 and send block to output
  **
- ** Parameters
+ ** Parameters      ctx : context
+ **                 blk : block from distributor
+ **                 id : index of encryptor
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-static int ecu_enc_execute(struct ecu_dist_msg *dist_msg)
+static int ecu_enc_execute(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id)
 {
-    unsigned int i, j;
-    unsigned char *data;
-    unsigned char *key;
-    unsigned char *enc_data;
-    unsigned int temp = 0;
-    int result = 0;
-    int sent = 0;
-    unsigned int enc_buf_avail;
+    const unsigned char *keystream;
+
+    /* use prebuilt keystream from offset of block */
+    keystream = ecu_get_keystream(ctx, blk->offset);
+
+    ecu_xor_block(blk->p_data, blk->p_data, keystream, blk->data_len);
 
-    enc_data = malloc(dist_msg->data_len);
-    data = dist_msg->p_data;
-    key = dist_msg->p_key;
+    ecu_enc_output(ctx, blk, id);
 
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_output
+ **
+ ** Description     send encrypted block to merger.
+ **                 positional output has fixed offset for every block,
+ **                 block is written there and goes back to pool
+ **
+ ** Parameters      ctx : context
+ **                 blk : encrypted block
+ **                 id : index of encryptor
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_enc_output(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id)
+{
+    unsigned long long offset;
 
-    for( i = 0 ; i < dist_msg->data_len ; i = i + dist_msg->key_len )
+    if( ctx->out_positional )
     {
-        for( j = 0; j < dist_msg->key_len ; j++)
+        offset = ctx->out_base + blk->offset;
+        if( ecu_io_pwrite(ctx->out_fd, blk->p_data, blk->data_len, offset) )
         {
-            enc_data[i+j] = (data[i+j] ^ key[j]) & 0xFF;
+            fprintf(stderr, "pwrite error %d\n", errno);
+            atomic_store(&ctx->enc.result, -1);
+        }
+        ecu_pool_put(&ctx->pool, blk);
+        return;
+    }
+
 #ifdef DEBUG
-            printf("%02x %02x %02x\n", enc_data[i+j], data[i+j], key[j]);
+    printf("ecu_enc_push_block! %llu\n", blk->seq_num);
 #endif
-        }
+    /* block is owned by merger from now */
+    ecu_enc_send_block(ctx, blk, id);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_get_block
+ **
+ ** Description     wait for a block from distributor
+ **
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **
+ ** Returns         block to encrypt
+ **                 NULL if woken up without block
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_enc_get_block(struct ecu_ctx *ctx, unsigned int id)
+{
+    if( ctx->enc.q_num )
+    {
+        return ecu_spsc_pop_wait(&ctx->enc.in_q[id]);
+    }
+    if( ctx->enc.dq_num )
+    {
+        return ecu_enc_dq_get(ctx, id);
+    }
+    return ecu_ring_pop_wait(&ctx->dist.rb);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_dq_get
+ **
+ ** Description     get a block in work stealing dispatch.
+ **                 own deque first, then a batch from DIST ring,
+ **                 then steal from other encryptors.
+ **                 wait on DIST ring when there is nothing at all
+ **
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **
+ ** Returns         block to encrypt
+ **                 NULL if woken up without block
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_enc_dq_get(struct ecu_ctx *ctx, unsigned int id)
+{
+    struct ecu_block *batch[ECU_ENC_STEAL_BATCH];
+    struct ecu_block *blk;
+    unsigned int cnt;
+
+    blk = ecu_deque_take(&ctx->enc.dq[id]);
+    if( blk )
+    {
+        return blk;
+    }
 
-        temp = 0;
-        /* 1-bit shift left key value */
-        for( j = 0 ; j < dist_msg->key_len ; j++)
+    for( cnt = 0 ; cnt < ECU_ENC_STEAL_BATCH ; cnt++ )
+    {
+        batch[cnt] = ecu_ring_pop(&ctx->dist.rb);
+        if( batch[cnt] == NULL )
+        {
+            break;
+        }
+        if( batch[cnt] == &ECU_BLOCK_EOS )
         {
-            temp = (key[j] << 1) | ((temp>>8)&1);
-            key[j] = (unsigned char)(temp & 0xFF);
-            if (j == dist_msg->key_len - 1)
+            /* only end of stream markers are left in ring.
+             * take one alone, so every encryptor gets one
+             */
+            if( cnt == 0 )
             {
-                key[0] = (unsigned char)((key[0]|(temp>>8)&1) & 0xFF);
+                return batch[0];
             }
+            ecu_ring_push_wait(&ctx->dist.rb, batch[cnt]);
+            break;
         }
-#ifdef DEBUG
-        for( j= 0 ; j < dist_msg->key_len ; j++)
+    }
+    if( cnt )
+    {
+        ecu_enc_dq_fill(ctx, id, batch, cnt);
+        return batch[0];
+    }
+
+    blk = ecu_enc_steal(ctx, id);
+    if( blk )
+    {
+        return blk;
+    }
+
+    return ecu_ring_pop_wait(&ctx->dist.rb);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_file_dq_get
+ **
+ ** Description     get a block of memory input in work stealing dispatch.
+ **                 a batch claims only as many block indices as pool blocks
+ **                 in hand, so every claimed index can be encrypted without
+ **                 waiting for pool
+ **
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **                 blk_cnt : number of blocks in input
+ **
+ ** Returns         pool block with seq_num of block index
+ **                 NULL if every block is taken
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_enc_file_dq_get(struct ecu_ctx *ctx, unsigned int id,
+                                             unsigned long long blk_cnt)
+{
+    struct ecu_block *batch[ECU_ENC_STEAL_BATCH];
+    struct ecu_block *blk;
+    unsigned long long idx;
+    unsigned int cnt, i;
+
+    blk = ecu_deque_take(&ctx->enc.dq[id]);
+    if( blk )
+    {
+        return blk;
+    }
+
+    for( cnt = 0 ; cnt < ECU_ENC_STEAL_BATCH ; cnt++ )
+    {
+        batch[cnt] = ecu_pool_try_get(&ctx->pool);
+        if( batch[cnt] == NULL )
         {
-            /* verify key */
-            printf("key:%d:%hhx\n", j, key[j] );
+            break;
         }
-#endif
+    }
+    if( cnt == 0 )
+    {
+        /* pool is empty, help others before waiting for pool */
+        blk = ecu_enc_steal(ctx, id);
+        if( blk )
+        {
+            return blk;
+        }
+        batch[0] = ecu_pool_get(&ctx->pool);
+        cnt = 1;
     }
 
-    sent = 0;
-    while(!sent)
+    idx = atomic_fetch_add_explicit(&ctx->enc.file_next, cnt, memory_order_relaxed);
+    if( idx >= blk_cnt )
     {
-        pthread_mutex_lock(&ECU_ENC_RB_IPC.lock);
-        /* check enc buffer is available */
-        enc_buf_avail = ecu_enc_get_avail_buf_cnt_in_rb();
-        if (enc_buf_avail > 3)
+        for( i = 0 ; i < cnt ; i++ )
         {
-            /* push data to ECU_ENC_RB */
-            result = ecu_enc_push_block(enc_data, dist_msg->data_len, dist_msg->seq_num);
-            sent = 1;
+            ecu_pool_put(&ctx->pool, batch[i]);
         }
-        else
+        return ecu_enc_steal(ctx, id);
+    }
+
+    for( i = 0 ; i < cnt ; i++ )
+    {
+        if( idx + i >= blk_cnt )
         {
-#ifdef DEBUG
-            printf("enc buffer full!\n");
-#endif
+            ecu_pool_put(&ctx->pool, batch[i]);
+            continue;
         }
-        pthread_mutex_unlock(&ECU_ENC_RB_IPC.lock);
+        batch[i]->seq_num = idx + i;
+    }
+    if( cnt > blk_cnt - idx )
+    {
+        cnt = blk_cnt - idx;
     }
-    free(data);
-    free(key);
 
-    return result;
+    ecu_enc_dq_fill(ctx, id, batch, cnt);
+    return batch[0];
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_enc_get_avail_buf_cnt_in_rb
+ ** Function        ecu_enc_dq_fill
  **
- ** Description     get available buffer count from ENC ring buffer
+ ** Description     put a batch but the first block into own deque.
+ **                 newest goes in first, so owner takes oldest next
+ **                 and thieves take newest, which would wait longest
  **
- ** Parameters
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **                 batch : blocks in sequence order
+ **                 cnt : number of blocks in batch
  **
- ** Returns         number of available buffers
+ ** Returns         none
  **
  *******************************************************************************/
-static unsigned int ecu_enc_get_avail_buf_cnt_in_rb()
+static void ecu_enc_dq_fill(struct ecu_ctx *ctx, unsigned int id,
+                            struct ecu_block **batch, unsigned int cnt)
 {
-    unsigned int result = 0;
-
-    if (ECU_ENC_RB_wptr == ECU_ENC_RB_rptr)
+    /* own deque is empty and larger than batch, push cannot fail */
+    while( cnt > 1 )
     {
-        result = ECU_ENC_MAX_QUEUE_NUM;
+        cnt--;
+        ecu_deque_push(&ctx->enc.dq[id], batch[cnt]);
     }
-    else if(ECU_ENC_RB_wptr > ECU_ENC_RB_rptr)
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_steal
+ **
+ ** Description     steal a block from deque of other encryptors,
+ **                 starting from next one
+ **
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **
+ ** Returns         stolen block
+ **                 NULL if nothing to steal
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_enc_steal(struct ecu_ctx *ctx, unsigned int id)
+{
+    struct ecu_block *blk;
+    unsigned int num, i;
+
+    num = ctx->enc.dq_num;
+    for( i = 1 ; i < num ; i++ )
     {
-        result = ECU_ENC_MAX_QUEUE_NUM - (ECU_ENC_RB_wptr - ECU_ENC_RB_rptr);
+        blk = ecu_deque_steal(&ctx->enc.dq[(id + i) % num]);
+        if( blk )
+        {
+            return blk;
+        }
     }
-    else if(ECU_ENC_RB_wptr < ECU_ENC_RB_rptr)
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_send_block
+ **
+ ** Description     send encrypted block to merger
+ **
+ ** Parameters      ctx : context
+ **                 blk : encrypted block
+ **                 id : index of encryptor
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_enc_send_block(struct ecu_ctx *ctx, struct ecu_block *blk, unsigned int id)
+{
+    if( ctx->enc.q_num )
     {
-        result = ECU_ENC_RB_rptr - ECU_ENC_RB_wptr;
+        ecu_spsc_push_wait(&ctx->enc.out_q[id], blk);
+        return;
     }
+    ecu_ring_push_wait(&ctx->enc.rb, blk);
+}
 
-    return result;
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_parse_dispatch
+ **
+ ** Description     convert name of dispatch to ECU_ENC_DISPATCH_xxx
+ **
+ ** Parameters      name : "shared", "rr" or "steal"
+ **
+ ** Returns         ECU_ENC_DISPATCH_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_enc_parse_dispatch(const char *name)
+{
+    if( strcmp(name, "shared") == 0 )
+    {
+        return ECU_ENC_DISPATCH_SHARED;
+    }
+    if( strcmp(name, "rr") == 0 )
+    {
+        return ECU_ENC_DISPATCH_RR;
+    }
+    if( strcmp(name, "steal") == 0 )
+    {
+        return ECU_ENC_DISPATCH_STEAL;
+    }
+    return -1;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_enc_push_block
+ ** Function        ecu_enc_get_in_q
  **
- ** Description     send encrypted block to encryption buffer
+ ** Description     get input queue of encryptor for a block
+ **                 in round-robin dispatch
  **
- ** Parameters      data : encrypted buffer pointer
- **                 len : length of encrypted data
- **                 seq : sequence number
+ ** Parameters      ctx : context
+ **                 seq : sequence number of block
  **
- ** Returns         number of available buffers
+ ** Returns         input queue of encryptor seq % N
  **
  *******************************************************************************/
-static int ecu_enc_push_block(unsigned char* data, unsigned int len, unsigned int seq)
+struct ecu_spsc *ecu_enc_get_in_q(struct ecu_ctx *ctx, unsigned long long seq)
 {
-    struct ecu_enc_msg *msg;
+    return &ctx->enc.in_q[seq % ctx->enc.q_num];
+}
 
-#ifdef DEBUG
-    printf("ecu_enc_push_block! %d\n", seq);
-#endif
-    msg = &ECU_ENC_RB[ECU_ENC_RB_wptr];
 
-    msg->data_len = len;
-    msg->p_enc_data = data;
-    msg->seq_num = seq;
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_get_out_q
+ **
+ ** Description     get output queue of encryptor for a block
+ **                 in round-robin dispatch
+ **
+ ** Parameters      ctx : context
+ **                 seq : sequence number of block
+ **
+ ** Returns         output queue of encryptor seq % N
+ **
+ *******************************************************************************/
+struct ecu_spsc *ecu_enc_get_out_q(struct ecu_ctx *ctx, unsigned long long seq)
+{
+    return &ctx->enc.out_q[seq % ctx->enc.q_num];
+}
 
-    ECU_ENC_RB_wptr++;
 
-    if (ECU_ENC_RB_wptr == ECU_ENC_MAX_QUEUE_NUM)
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_send_eos
+ **
+ ** Description     pass end of stream marker to merger after last block
+ **                 of encryptor. positional and memory output have no merger
+ **
+ ** Parameters      ctx : context
+ **                 id : index of encryptor
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_enc_send_eos(struct ecu_ctx *ctx, unsigned int id)
+{
+    if( ecu_has_merger(ctx) )
     {
-        ECU_ENC_RB_wptr = 0;
+        ecu_enc_send_block(ctx, &ECU_BLOCK_EOS, id);
     }
-    if (ECU_ENC_RB_wptr == ECU_ENC_RB_rptr)
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_t_join
+ **
+ ** Description     wait for every encryptor thread to finish
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if positional output failed
+ **
+ *******************************************************************************/
+int ecu_enc_t_join(struct ecu_ctx *ctx)
+{
+    unsigned int i;
+
+    for( i = 0 ; i < ctx->enc.t_num ; i++ )
     {
-        /* ring buffer overflow */
-#ifdef DEBUG
-        printf("error! ENC ring buffer full!!\n");
-#endif
-        return -1;
+        ecu_worker_join(&ctx->workers, ctx->enc.tid[i]);
     }
+    ctx->enc.t_num = 0;
 
-    return 0;
+    return atomic_load(&ctx->enc.result);
 }
 
 
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_destroy
+ **
+ ** Description     release ring buffer and queues of encryptors
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_enc_destroy(struct ecu_ctx *ctx)
+{
+    struct ecu_enc *enc = &ctx->enc;
+    unsigned int i;
+
+    for( i = 0 ; i < enc->q_num ; i++ )
+    {
+        ecu_spsc_destroy(&enc->in_q[i]);
+        ecu_spsc_destroy(&enc->out_q[i]);
+    }
+    for( i = 0 ; i < enc->dq_num ; i++ )
+    {
+        ecu_deque_destroy(&enc->dq[i]);
+    }
+    free(enc->in_q);
+    free(enc->out_q);
+    free(enc->dq);
+    free(enc->tid);
+    free(enc->arg);
+    ecu_ring_destroy(&enc->rb);
+    memset(enc, 0, sizeof(*enc));
+}
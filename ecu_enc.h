@@ -2,51 +2,92 @@
 #ifndef ECU_ENC_H
 #define ECU_ENC_H
 
-/* Maximum encryption thread number */
-#define ECU_ENC_MAX_THREAD_NUM 10
+#include <pthread.h>
+#include <stdatomic.h>
 
+#include "ecu.h"
+#include "ecu_ring.h"
+#include "ecu_deque.h"
 
-#define ECU_ENC_MAX_QUEUE_NUM 100
+/* Maximum encryption thread number.
+ * every thread holds a pool block, pool must stay within reorder buffer
+ */
+#define ECU_ENC_MAX_THREAD_NUM 256
 
-struct ecu_enc_msg
+
+/* Encryptor ring buffer size, power of 2 */
+#define ECU_ENC_MAX_QUEUE_NUM 128
+
+/* Maximum per-encryptor queue size of round-robin dispatch, power of 2 */
+#define ECU_ENC_RR_QUEUE_NUM 32
+
+/* blocks taken at once into own deque of work stealing dispatch */
+#define ECU_ENC_STEAL_BATCH 4
+
+/* deque size of work stealing dispatch, power of 2 */
+#define ECU_ENC_STEAL_QUEUE_NUM 8
+
+struct ecu_ctx;
+
+/* argument of one encryptor thread */
+struct ecu_enc_arg
 {
-    unsigned int seq_num;
-    unsigned char *p_enc_data;
-    unsigned int data_len;
+    struct ecu_ctx *ctx;
+    unsigned int id;            /* index of encryptor */
 };
 
-struct enc_queue_ipc {
-    pthread_mutex_t   lock;
+/* encryptors of a context */
+struct ecu_enc
+{
+    pthread_t *tid;             /* N encrypt threads */
+    struct ecu_enc_arg *arg;
+    unsigned int t_num;         /* number of started threads */
+    struct ecu_ring rb;         /* ring buffer between encryptor and merger */
+
+    /* per-encryptor queues of round-robin dispatch */
+    struct ecu_spsc *in_q;
+    struct ecu_spsc *out_q;
+    unsigned int q_num;
+
+    /* per-encryptor deques of work stealing dispatch */
+    struct ecu_deque *dq;
+    unsigned int dq_num;
+
+    atomic_ullong file_next;    /* next block of memory input to be encrypted */
+    atomic_int result;          /* -1 if positional output failed */
+    atomic_int stop;            /* 1 : stop taking blocks of memory input */
 };
 
 /*******************************************************************************
  **
- ** Function        ecu_enc_m_start
+ ** Function        ecu_enc_rb_start
  **
- ** Description     init mutex for enc ring buffer
+ ** Description     init enc ring buffer
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-int ecu_enc_m_start();
+int ecu_enc_rb_start(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
  **
  ** Function        ecu_enc_t_start
  **
- ** Description     create encryptor thread
+ ** Description     create encryptor threads. if a thread can not be
+ **                 created, started ones are stopped and merger gets end
+ **                 of stream of every encryptor
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-int ecu_enc_t_start();
+int ecu_enc_t_start(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -55,12 +96,13 @@ int ecu_enc_t_start();
  **
  ** Description     pop encrypted block from encryption buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
- ** Returns         pointer to encrypt ring buffer
+ ** Returns         pointer to encrypted block
+ **                 NULL if ring buffer is empty
  **
  *******************************************************************************/
-struct ecu_enc_msg * ecu_enc_pop_block();
+struct ecu_block * ecu_enc_pop_block(struct ecu_ctx *ctx);
 
 
 /*******************************************************************************
@@ -69,12 +111,89 @@ struct ecu_enc_msg * ecu_enc_pop_block();
  **
  ** Description     get number of block in encriptor ring buffer
  **
- ** Parameters      none
+ ** Parameters      ctx : context
  **
  ** Returns         number of block
  **
  *******************************************************************************/
-unsigned int ecu_enc_get_block_cnt_in_rb();
+unsigned int ecu_enc_get_block_cnt_in_rb(struct ecu_ctx *ctx);
+
+
 
 
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_parse_dispatch
+ **
+ ** Description     convert name of dispatch to ECU_ENC_DISPATCH_xxx
+ **
+ ** Parameters      name : "shared", "rr" or "steal"
+ **
+ ** Returns         ECU_ENC_DISPATCH_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_enc_parse_dispatch(const char *name);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_get_in_q
+ **
+ ** Description     get input queue of encryptor for a block
+ **                 in round-robin dispatch
+ **
+ ** Parameters      ctx : context
+ **                 seq : sequence number of block
+ **
+ ** Returns         input queue of encryptor seq % N
+ **
+ *******************************************************************************/
+struct ecu_spsc *ecu_enc_get_in_q(struct ecu_ctx *ctx, unsigned long long seq);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_get_out_q
+ **
+ ** Description     get output queue of encryptor for a block
+ **                 in round-robin dispatch
+ **
+ ** Parameters      ctx : context
+ **                 seq : sequence number of block
+ **
+ ** Returns         output queue of encryptor seq % N
+ **
+ *******************************************************************************/
+struct ecu_spsc *ecu_enc_get_out_q(struct ecu_ctx *ctx, unsigned long long seq);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_t_join
+ **
+ ** Description     wait for every encryptor thread to finish
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if positional output failed
+ **
+ *******************************************************************************/
+int ecu_enc_t_join(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_enc_destroy
+ **
+ ** Description     release ring buffer and queues of encryptors
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_enc_destroy(struct ecu_ctx *ctx);
+
 #endif
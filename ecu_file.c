@@ -0,0 +1,607 @@
+/*****************************************************************************
+**
+**  Name:           ecu_file.c
+**
+**  Description:    regular file input and output of encryptUtil.
+**                  every block of a file has a fixed offset, so mapped
+**                  input and output go to libecu as memory and output
+**                  file as positional fd, without distributor or merger.
+**                  file list of batch mode.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ecu_file.h"
+
+/* mapped input file */
+static const unsigned char *ecu_file_in_data = NULL;
+static size_t ecu_file_in_size = 0;
+static struct stat ecu_file_in_st;
+static int ecu_file_in_opened = 0;
+
+/* output file */
+static int ecu_file_out_fd = -1;
+static unsigned char *ecu_file_out_data = NULL;
+static size_t ecu_file_out_size = 0;
+
+/* file pairs of batch */
+static char **ecu_file_batch_in = NULL;
+static char **ecu_file_batch_out = NULL;
+static unsigned int ecu_file_batch_cnt = 0;
+static unsigned int ecu_file_batch_max = 0;
+
+
+/* static function definitions */
+static int ecu_file_batch_add(const char *in, const char *out);
+static int ecu_file_batch_load_list(const char *path);
+static int ecu_file_batch_load_dir(const char *path, const char *out_dir);
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_open
+ **
+ ** Description     map regular input file to memory.
+ **                 encryptors read blocks from the mapping by offset
+ **
+ ** Parameters      path : input file
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_in_open(const char *path)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if( fd < 0 )
+    {
+        fprintf(stderr, "cannot open input file %s\n", path);
+        return -1;
+    }
+
+    if( fstat(fd, &st) || !S_ISREG(st.st_mode) )
+    {
+        fprintf(stderr, "input file should be a regular file %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    /* whole file is mapped at once */
+    if( (unsigned long long)st.st_size > SIZE_MAX )
+    {
+        fprintf(stderr, "input file is too large %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    /* empty file can not be mapped */
+    if( st.st_size > 0 )
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if( data == MAP_FAILED )
+        {
+            fprintf(stderr, "mmap error %d\n", errno);
+            close(fd);
+            return -1;
+        }
+        /* encryptors walk file from start to end */
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        ecu_file_in_data = data;
+    }
+    ecu_file_in_size = (size_t)st.st_size;
+    ecu_file_in_st = st;
+    ecu_file_in_opened = 1;
+
+    /* mapping stays valid after close */
+    close(fd);
+
+#ifdef DEBUG
+    printf("input file %s %zu bytes\n", path, ecu_file_in_size);
+#endif
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_get_data
+ **
+ ** Description     get mapped data of input file
+ **
+ ** Parameters      none
+ **
+ ** Returns         pointer to first byte of input file
+ **                 NULL if input file is empty
+ **
+ *******************************************************************************/
+const unsigned char *ecu_file_in_get_data()
+{
+    return ecu_file_in_data;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_get_size
+ **
+ ** Description     get size of input file
+ **
+ ** Parameters      none
+ **
+ ** Returns         size of input file (byte)
+ **
+ *******************************************************************************/
+size_t ecu_file_in_get_size()
+{
+    return ecu_file_in_size;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_open
+ **
+ ** Description     create output file. each block is written at its own
+ **                 offset, so output needs no reorder.
+ **                 if output size is known, file is mapped to memory
+ **
+ ** Parameters      path : output file
+ **                 map_size : size of output to be mapped,
+ **                            0 is written with pwrite()
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_out_open(const char *path, size_t map_size)
+{
+    struct stat in_st, out_st;
+    void *data;
+    int fd;
+
+    /* truncating output must not destroy input */
+    if( ecu_file_in_opened )
+    {
+        in_st = ecu_file_in_st;
+    }
+    else if( fstat(STDIN_FILENO, &in_st) )
+    {
+        in_st.st_ino = 0;
+    }
+    if( (stat(path, &out_st) == 0) && (in_st.st_ino != 0)
+        && (out_st.st_dev == in_st.st_dev) && (out_st.st_ino == in_st.st_ino) )
+    {
+        fprintf(stderr, "output file is same as input %s\n", path);
+        return -1;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if( fd < 0 )
+    {
+        fprintf(stderr, "cannot open output file %s\n", path);
+        return -1;
+    }
+
+    if( map_size > 0 )
+    {
+        /* size file at once, encryptors store blocks into the mapping */
+        if( ftruncate(fd, map_size) )
+        {
+            fprintf(stderr, "ftruncate error %d\n", errno);
+            close(fd);
+            return -1;
+        }
+        data = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if( data == MAP_FAILED )
+        {
+            fprintf(stderr, "mmap error %d\n", errno);
+            close(fd);
+            return -1;
+        }
+        ecu_file_out_data = data;
+        ecu_file_out_size = map_size;
+    }
+    ecu_file_out_fd = fd;
+
+#ifdef DEBUG
+    printf("output file %s mapped %zu bytes\n", path, map_size);
+#endif
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_get_data
+ **
+ ** Description     get mapped data of output file
+ **
+ ** Parameters      none
+ **
+ ** Returns         pointer to first byte of output file
+ **                 NULL if output file is not mapped
+ **
+ *******************************************************************************/
+unsigned char *ecu_file_out_get_data()
+{
+    return ecu_file_out_data;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_get_fd
+ **
+ ** Description     get fd of output file
+ **
+ ** Parameters      none
+ **
+ ** Returns         file descriptor
+ **
+ *******************************************************************************/
+int ecu_file_out_get_fd()
+{
+    return ecu_file_out_fd;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_close
+ **
+ ** Description     close output file after every encryptor is finished
+ **
+ ** Parameters      none
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_out_close()
+{
+    int result = 0;
+
+    if( ecu_file_out_data )
+    {
+        munmap(ecu_file_out_data, ecu_file_out_size);
+        ecu_file_out_data = NULL;
+    }
+
+    /* delayed write error of file system shows up at close */
+    if( close(ecu_file_out_fd) )
+    {
+        fprintf(stderr, "close error %d\n", errno);
+        result = -1;
+    }
+    ecu_file_out_fd = -1;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_open
+ **
+ ** Description     build file list of batch.
+ **                 path is a list file with "input output" on each line,
+ **                 or a directory whose regular files are written to
+ **                 files of same name in out_dir
+ **
+ ** Parameters      path : list file or input directory
+ **                 out_dir : output directory, only for input directory
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_batch_open(const char *path, const char *out_dir)
+{
+    struct stat st;
+    int result;
+
+    if( stat(path, &st) )
+    {
+        fprintf(stderr, "cannot open batch %s\n", path);
+        return -1;
+    }
+
+    if( S_ISDIR(st.st_mode) )
+    {
+        if( out_dir == NULL )
+        {
+            fprintf(stderr, "batch directory %s needs output directory\n", path);
+            return -1;
+        }
+        result = ecu_file_batch_load_dir(path, out_dir);
+    }
+    else
+    {
+        result = ecu_file_batch_load_list(path);
+    }
+
+    if( result )
+    {
+        ecu_file_batch_close();
+    }
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_in
+ **
+ ** Description     get input files of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         array of input paths
+ **
+ *******************************************************************************/
+const char *const *ecu_file_batch_get_in()
+{
+    return (const char *const *)ecu_file_batch_in;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_out
+ **
+ ** Description     get output files of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         array of output paths
+ **
+ *******************************************************************************/
+const char *const *ecu_file_batch_get_out()
+{
+    return (const char *const *)ecu_file_batch_out;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_cnt
+ **
+ ** Description     get number of files in batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         number of files
+ **
+ *******************************************************************************/
+unsigned int ecu_file_batch_get_cnt()
+{
+    return ecu_file_batch_cnt;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_close
+ **
+ ** Description     free file list of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_file_batch_close()
+{
+    unsigned int i;
+
+    for( i = 0 ; i < ecu_file_batch_cnt ; i++ )
+    {
+        free(ecu_file_batch_in[i]);
+        free(ecu_file_batch_out[i]);
+    }
+    free(ecu_file_batch_in);
+    free(ecu_file_batch_out);
+    ecu_file_batch_in = NULL;
+    ecu_file_batch_out = NULL;
+    ecu_file_batch_cnt = 0;
+    ecu_file_batch_max = 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_add
+ **
+ ** Description     add a file pair to batch.
+ **                 output must not be its own input, it is truncated
+ **                 while input may still be read
+ **
+ ** Parameters      in : input file
+ **                 out : output file
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_file_batch_add(const char *in, const char *out)
+{
+    struct stat in_st, out_st;
+    char **list;
+    unsigned int max;
+
+    if( (stat(in, &in_st) == 0) && (stat(out, &out_st) == 0) &&
+        (in_st.st_dev == out_st.st_dev) && (in_st.st_ino == out_st.st_ino) )
+    {
+        fprintf(stderr, "output file is same as input %s\n", out);
+        return -1;
+    }
+
+    if( ecu_file_batch_cnt == ecu_file_batch_max )
+    {
+        max = ecu_file_batch_max ? ecu_file_batch_max * 2 : 64;
+        list = realloc(ecu_file_batch_in, max * sizeof(char *));
+        if( list == NULL )
+        {
+            fprintf(stderr, "batch alloc error!\n");
+            return -1;
+        }
+        ecu_file_batch_in = list;
+        list = realloc(ecu_file_batch_out, max * sizeof(char *));
+        if( list == NULL )
+        {
+            fprintf(stderr, "batch alloc error!\n");
+            return -1;
+        }
+        ecu_file_batch_out = list;
+        ecu_file_batch_max = max;
+    }
+
+    ecu_file_batch_in[ecu_file_batch_cnt] = strdup(in);
+    ecu_file_batch_out[ecu_file_batch_cnt] = strdup(out);
+    if( (ecu_file_batch_in[ecu_file_batch_cnt] == NULL) ||
+        (ecu_file_batch_out[ecu_file_batch_cnt] == NULL) )
+    {
+        free(ecu_file_batch_in[ecu_file_batch_cnt]);
+        free(ecu_file_batch_out[ecu_file_batch_cnt]);
+        fprintf(stderr, "batch alloc error!\n");
+        return -1;
+    }
+    ecu_file_batch_cnt++;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_load_list
+ **
+ ** Description     read list file, "input output" on each line.
+ **                 paths are separated by spaces or tabs, empty lines
+ **                 are skipped
+ **
+ ** Parameters      path : list file
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_file_batch_load_list(const char *path)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t line_size = 0;
+    char *in, *out, *extra, *save;
+    unsigned int line_num = 0;
+    int result = 0;
+
+    fp = fopen(path, "r");
+    if( fp == NULL )
+    {
+        fprintf(stderr, "cannot open batch list %s\n", path);
+        return -1;
+    }
+
+    while( getline(&line, &line_size, fp) >= 0 )
+    {
+        line_num++;
+        in = strtok_r(line, " \t\r\n", &save);
+        if( in == NULL )
+        {
+            continue;
+        }
+        out = strtok_r(NULL, " \t\r\n", &save);
+        extra = strtok_r(NULL, " \t\r\n", &save);
+        if( (out == NULL) || (extra != NULL) )
+        {
+            fprintf(stderr, "error batch list %s line %u, input output\n", path, line_num);
+            result = -1;
+            break;
+        }
+        result = ecu_file_batch_add(in, out);
+        if( result )
+        {
+            break;
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_load_dir
+ **
+ ** Description     add every regular file of directory in name order
+ **
+ ** Parameters      path : input directory
+ **                 out_dir : output directory
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_file_batch_load_dir(const char *path, const char *out_dir)
+{
+    struct dirent **names;
+    struct stat st;
+    char *in, *out;
+    int num, i;
+    int result = 0;
+
+    if( (stat(out_dir, &st) != 0) || !S_ISDIR(st.st_mode) )
+    {
+        fprintf(stderr, "output directory %s does not exist\n", out_dir);
+        return -1;
+    }
+
+    num = scandir(path, &names, NULL, alphasort);
+    if( num < 0 )
+    {
+        fprintf(stderr, "cannot read directory %s\n", path);
+        return -1;
+    }
+
+    for( i = 0 ; i < num ; i++ )
+    {
+        if( result == 0 )
+        {
+            in = NULL;
+            out = NULL;
+            if( (asprintf(&in, "%s/%s", path, names[i]->d_name) < 0) ||
+                (asprintf(&out, "%s/%s", out_dir, names[i]->d_name) < 0) )
+            {
+                fprintf(stderr, "batch alloc error!\n");
+                result = -1;
+            }
+            else if( (stat(in, &st) == 0) && S_ISREG(st.st_mode) )
+            {
+                result = ecu_file_batch_add(in, out);
+            }
+            free(in);
+            free(out);
+        }
+        free(names[i]);
+    }
+    free(names);
+
+    return result;
+}
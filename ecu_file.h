@@ -0,0 +1,188 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_FILE_H
+#define ECU_FILE_H
+
+#include <stddef.h>
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_open
+ **
+ ** Description     map regular input file to memory.
+ **                 encryptors read blocks from the mapping by offset
+ **
+ ** Parameters      path : input file
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_in_open(const char *path);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_get_data
+ **
+ ** Description     get mapped data of input file
+ **
+ ** Parameters      none
+ **
+ ** Returns         pointer to first byte of input file
+ **                 NULL if input file is empty
+ **
+ *******************************************************************************/
+const unsigned char *ecu_file_in_get_data();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_in_get_size
+ **
+ ** Description     get size of input file
+ **
+ ** Parameters      none
+ **
+ ** Returns         size of input file (byte)
+ **
+ *******************************************************************************/
+size_t ecu_file_in_get_size();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_open
+ **
+ ** Description     create output file. each block is written at its own
+ **                 offset, so output needs no reorder.
+ **                 if output size is known, file is mapped to memory
+ **
+ ** Parameters      path : output file
+ **                 map_size : size of output to be mapped,
+ **                            0 is written with pwrite()
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_out_open(const char *path, size_t map_size);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_get_data
+ **
+ ** Description     get mapped data of output file
+ **
+ ** Parameters      none
+ **
+ ** Returns         pointer to first byte of output file
+ **                 NULL if output file is not mapped
+ **
+ *******************************************************************************/
+unsigned char *ecu_file_out_get_data();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_get_fd
+ **
+ ** Description     get fd of output file
+ **
+ ** Parameters      none
+ **
+ ** Returns         file descriptor
+ **
+ *******************************************************************************/
+int ecu_file_out_get_fd();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_out_close
+ **
+ ** Description     close output file after every encryptor is finished
+ **
+ ** Parameters      none
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_out_close();
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_open
+ **
+ ** Description     build file list of batch.
+ **                 path is a list file with "input output" on each line,
+ **                 or a directory whose regular files are written to
+ **                 files of same name in out_dir
+ **
+ ** Parameters      path : list file or input directory
+ **                 out_dir : output directory, only for input directory
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_file_batch_open(const char *path, const char *out_dir);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_in
+ **
+ ** Description     get input files of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         array of input paths
+ **
+ *******************************************************************************/
+const char *const *ecu_file_batch_get_in();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_out
+ **
+ ** Description     get output files of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         array of output paths
+ **
+ *******************************************************************************/
+const char *const *ecu_file_batch_get_out();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_get_cnt
+ **
+ ** Description     get number of files in batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         number of files
+ **
+ *******************************************************************************/
+unsigned int ecu_file_batch_get_cnt();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_file_batch_close
+ **
+ ** Description     free file list of batch
+ **
+ ** Parameters      none
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_file_batch_close();
+
+#endif
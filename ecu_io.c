@@ -0,0 +1,295 @@
+/*****************************************************************************
+**
+**  Name:           ecu_io.c
+**
+**  Description:    I/O engine selection, pipe and file helpers
+**                  for input and output fd.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "ecu_io.h"
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_parse_engine
+ **
+ ** Description     convert name of I/O engine to ECU_IO_xxx
+ **
+ ** Parameters      name : "sync", "splice" or "uring"
+ **
+ ** Returns         ECU_IO_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_io_parse_engine(const char *name)
+{
+    if( strcmp(name, "sync") == 0 )
+    {
+        return ECU_IO_SYNC;
+    }
+    if( strcmp(name, "splice") == 0 )
+    {
+        return ECU_IO_SPLICE;
+    }
+    if( strcmp(name, "uring") == 0 )
+    {
+        return ECU_IO_URING;
+    }
+    return -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pipe_grow
+ **
+ ** Description     enlarge pipe up to size so that each wakeup moves
+ **                 more data. kernel may allow less than size
+ **
+ ** Parameters      fd : file descriptor
+ **                 size : wanted pipe size (byte)
+ **
+ ** Returns         pipe size (byte)
+ **                 0 if fd is not a pipe
+ **
+ *******************************************************************************/
+unsigned int ecu_io_pipe_grow(int fd, unsigned int size)
+{
+    struct stat st;
+    int pipe_size;
+
+    if( fstat(fd, &st) || !S_ISFIFO(st.st_mode) )
+    {
+        return 0;
+    }
+
+    pipe_size = fcntl(fd, F_GETPIPE_SZ);
+    if( pipe_size < 0 )
+    {
+        return 0;
+    }
+
+    /* above /proc/sys/fs/pipe-max-size fails without privilege,
+     * current size is kept then
+     */
+    if( (unsigned int)pipe_size < size )
+    {
+        if( fcntl(fd, F_SETPIPE_SZ, size) >= 0 )
+        {
+            pipe_size = fcntl(fd, F_GETPIPE_SZ);
+        }
+    }
+
+#ifdef DEBUG
+    printf("pipe %d size %d\n", fd, pipe_size);
+#endif
+    return (pipe_size > 0) ? (unsigned int)pipe_size : 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_is_file
+ **
+ ** Description     check fd is a regular file accessed by offset.
+ **                 output in append mode ignores offset
+ **
+ ** Parameters      fd : file descriptor
+ **                 write : 1 is output, 0 is input
+ **
+ ** Returns         1 is regular file
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_io_is_file(int fd, int write)
+{
+    struct stat st;
+    int flags;
+
+    if( fstat(fd, &st) || !S_ISREG(st.st_mode) )
+    {
+        return 0;
+    }
+
+    if( write )
+    {
+        flags = fcntl(fd, F_GETFL);
+        if( (flags < 0) || (flags & O_APPEND) )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pwrite
+ **
+ ** Description     write whole data at an offset of file
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : data to write
+ **                 len : length of data
+ **                 offset : offset of data in file
+ **
+ ** Returns         0 is success
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_pwrite(int fd, const unsigned char *data, unsigned int len,
+                  unsigned long long offset)
+{
+    ssize_t result;
+
+    while( len > 0 )
+    {
+        result = pwrite(fd, data, len, (off_t)offset);
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += result;
+        len -= (unsigned int)result;
+        offset += (unsigned long long)result;
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pread
+ **
+ ** Description     read data at an offset of file until length or
+ **                 end of file
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : buffer
+ **                 len : length to read
+ **                 offset : offset of data in file
+ **
+ ** Returns         length read, less than len at end of file
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_pread(int fd, unsigned char *data, unsigned int len,
+                 unsigned long long offset)
+{
+    ssize_t result;
+    unsigned int done = 0;
+
+    while( done < len )
+    {
+        result = pread(fd, data + done, len - done, (off_t)(offset + done));
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        if( result == 0 )
+        {
+            break;
+        }
+        done += (unsigned int)result;
+    }
+
+    return (int)done;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_write
+ **
+ ** Description     write whole data to fd
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : data to write
+ **                 len : length of data
+ **
+ ** Returns         0 is success
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_write(int fd, const unsigned char *data, unsigned int len)
+{
+    ssize_t result;
+
+    while( len > 0 )
+    {
+        result = write(fd, data, len);
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += result;
+        len -= (unsigned int)result;
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_read
+ **
+ ** Description     read data from fd until length or end of stream
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : buffer
+ **                 len : length to read
+ **
+ ** Returns         length read, less than len at end of stream
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_read(int fd, unsigned char *data, unsigned int len)
+{
+    ssize_t result;
+    unsigned int done = 0;
+
+    while( done < len )
+    {
+        result = read(fd, data + done, len - done);
+        if( result < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        if( result == 0 )
+        {
+            break;
+        }
+        done += (unsigned int)result;
+    }
+
+    return (int)done;
+}
@@ -0,0 +1,127 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_IO_H
+#define ECU_IO_H
+
+/* I/O engine ECU_IO_xxx */
+#include "ecu.h"
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_parse_engine
+ **
+ ** Description     convert name of I/O engine to ECU_IO_xxx
+ **
+ ** Parameters      name : "sync", "splice" or "uring"
+ **
+ ** Returns         ECU_IO_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_io_parse_engine(const char *name);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pipe_grow
+ **
+ ** Description     enlarge pipe up to size so that each wakeup moves
+ **                 more data. kernel may allow less than size
+ **
+ ** Parameters      fd : file descriptor
+ **                 size : wanted pipe size (byte)
+ **
+ ** Returns         pipe size (byte)
+ **                 0 if fd is not a pipe
+ **
+ *******************************************************************************/
+unsigned int ecu_io_pipe_grow(int fd, unsigned int size);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_is_file
+ **
+ ** Description     check fd is a regular file accessed by offset.
+ **                 output in append mode ignores offset
+ **
+ ** Parameters      fd : file descriptor
+ **                 write : 1 is output, 0 is input
+ **
+ ** Returns         1 is regular file
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_io_is_file(int fd, int write);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pwrite
+ **
+ ** Description     write whole data at an offset of file
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : data to write
+ **                 len : length of data
+ **                 offset : offset of data in file
+ **
+ ** Returns         0 is success
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_pwrite(int fd, const unsigned char *data, unsigned int len,
+                  unsigned long long offset);
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_pread
+ **
+ ** Description     read data at an offset of file until length or
+ **                 end of file
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : buffer
+ **                 len : length to read
+ **                 offset : offset of data in file
+ **
+ ** Returns         length read, less than len at end of file
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_pread(int fd, unsigned char *data, unsigned int len,
+                 unsigned long long offset);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_write
+ **
+ ** Description     write whole data to fd
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : data to write
+ **                 len : length of data
+ **
+ ** Returns         0 is success
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_write(int fd, const unsigned char *data, unsigned int len);
+
+/*******************************************************************************
+ **
+ ** Function        ecu_io_read
+ **
+ ** Description     read data from fd until length or end of stream
+ **
+ ** Parameters      fd : file descriptor
+ **                 data : buffer
+ **                 len : length to read
+ **
+ ** Returns         length read, less than len at end of stream
+ **                 -1 is error, errno is set
+ **
+ *******************************************************************************/
+int ecu_io_read(int fd, unsigned char *data, unsigned int len);
+
+#endif
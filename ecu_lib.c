@@ -0,0 +1,1096 @@
+/*****************************************************************************
+**
+**  Name:           ecu_lib.c
+**
+**  Description:    libecu, XOR stream encryptor library.
+**                  a context holds key, keystream, block pool and
+**                  ring buffers of one stream. each run starts
+**                  distributor, encryptor and merger threads of the
+**                  context and joins them at end of stream, or hands
+**                  them to threads parked by the context.
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "ecu.h"
+#include "ecu_ctx.h"
+#include "ecu_dist.h"
+#include "ecu_enc.h"
+#include "ecu_merger.h"
+#include "ecu_xor.h"
+#include "ecu_ring.h"
+#include "ecu_pool.h"
+#include "ecu_cpu.h"
+#include "ecu_io.h"
+#include "ecu_worker.h"
+
+
+/* static function definitions */
+static int ecu_set_config(struct ecu_ctx *ctx, const struct ecu_config *cfg);
+static int ecu_set_block_size(struct ecu_ctx *ctx, unsigned int size);
+static int ecu_build_keystream(struct ecu_ctx *ctx);
+static int ecu_pool_start(struct ecu_ctx *ctx);
+static int ecu_run(struct ecu_ctx *ctx);
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_config_init
+ **
+ ** Description     set default configuration
+ **
+ ** Parameters      cfg : configuration
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_config_init(struct ecu_config *cfg)
+{
+    memset(cfg, 0, sizeof(struct ecu_config));
+    cfg->read_size = ECU_DIST_READ_SIZE;
+    cfg->flush_size = ECU_MERGER_FLUSH_SIZE;
+    cfg->wait_mode = ECU_WAIT_HYBRID;
+    cfg->io_engine = ECU_IO_SYNC;
+    cfg->dispatch = ECU_ENC_DISPATCH_SHARED;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_create
+ **
+ ** Description     create context of a stream. key is copied, keystream
+ **                 and every data block are allocated here
+ **
+ ** Parameters      key : key data
+ **                 key_size : size of key, 1 byte to 16 MiB
+ **                 cfg : configuration, NULL is default
+ **
+ ** Returns         context
+ **                 NULL is error
+ **
+ *******************************************************************************/
+struct ecu_ctx *ecu_create(const unsigned char *key, size_t key_size,
+                           const struct ecu_config *cfg)
+{
+    struct ecu_config def;
+    struct ecu_ctx *ctx;
+    unsigned int block_size;
+
+    if( cfg == NULL )
+    {
+        ecu_config_init(&def);
+        cfg = &def;
+    }
+
+    if( (key == NULL) || (key_size == 0) || (key_size > ECU_KEY_MAX) )
+    {
+        fprintf(stderr, "Key size should be 1 to %d! %zu\n", ECU_KEY_MAX, key_size);
+        return NULL;
+    }
+
+    /* ring buffers in context are aligned to cache line */
+    ctx = aligned_alloc(ECU_RING_CACHE_LINE, sizeof(struct ecu_ctx));
+    if( ctx == NULL )
+    {
+        fprintf(stderr, "context alloc error!\n");
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(struct ecu_ctx));
+    ctx->in_fd = -1;
+    ctx->out_fd = -1;
+
+    if( ecu_set_config(ctx, cfg) )
+    {
+        ecu_destroy(ctx);
+        return NULL;
+    }
+
+    ctx->cb.key = malloc(key_size);
+    if( ctx->cb.key == NULL )
+    {
+        fprintf(stderr, "key alloc error!\n");
+        ecu_destroy(ctx);
+        return NULL;
+    }
+    memcpy(ctx->cb.key, key, key_size);
+    ctx->cb.key_size = (unsigned int)key_size;
+
+    /* key rotation restarts every key size x 8 bytes.
+     * default block is as many periods as fit in ECU_BLOCK_DEFAULT_SIZE,
+     * longer period is split into blocks of ECU_BLOCK_DEFAULT_SIZE
+     */
+    ctx->cb.key_period = ctx->cb.key_size * 8;
+    block_size = cfg->block_size;
+    if( block_size == 0 )
+    {
+        block_size = (ECU_BLOCK_DEFAULT_SIZE / ctx->cb.key_period) * ctx->cb.key_period;
+        if( block_size == 0 )
+        {
+            block_size = ECU_BLOCK_DEFAULT_SIZE;
+        }
+    }
+
+    /* build keystream of one block, select XOR kernel for this CPU
+     * and allocate every data block before threads start
+     */
+    if( ecu_set_block_size(ctx, block_size) ||
+        ecu_worker_init(&ctx->workers,
+                        cfg->keep_threads ? ctx->cb.num_of_enc_thread + 2 : 0) ||
+        ecu_build_keystream(ctx) ||
+        ecu_xor_init() ||
+        ecu_pool_start(ctx) ||
+        ecu_dist_rb_start(ctx) ||
+        ecu_enc_rb_start(ctx) )
+    {
+        ecu_destroy(ctx);
+        return NULL;
+    }
+
+    return ctx;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_fd
+ **
+ ** Description     encrypt input fd until end of stream into output fd.
+ **                 output is in input order
+ **
+ ** Parameters      ctx : context
+ **                 in_fd : input
+ **                 out_fd : output
+ **                 flags : ECU_OUT_xxx
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_fd(struct ecu_ctx *ctx, int in_fd, int out_fd, unsigned int flags)
+{
+    if( (ctx == NULL) || (in_fd < 0) || (out_fd < 0) )
+    {
+        return -1;
+    }
+
+    ctx->in_fd = in_fd;
+    ctx->in_data = NULL;
+    ctx->in_size = 0;
+    ctx->out_fd = out_fd;
+    ctx->out_data = NULL;
+    ctx->out_positional = (flags & ECU_OUT_POSITIONAL) ? 1 : 0;
+
+    return ecu_run(ctx);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer
+ **
+ ** Description     encrypt memory into memory.
+ **                 data of one block is done in calling thread
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 out : output, len bytes. can be same as in
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer(struct ecu_ctx *ctx, const void *in, size_t len, void *out)
+{
+    if( (ctx == NULL) || ((len > 0) && ((in == NULL) || (out == NULL))) )
+    {
+        return -1;
+    }
+    if( len == 0 )
+    {
+        return 0;
+    }
+
+    /* starting threads costs more than XOR of a block */
+    if( len <= ecu_get_block_size(ctx) )
+    {
+        ecu_xor_block(out, in, ecu_get_keystream(ctx, 0), (unsigned int)len);
+        return 0;
+    }
+
+    ctx->in_fd = -1;
+    ctx->in_data = in;
+    ctx->in_size = len;
+    ctx->out_fd = -1;
+    ctx->out_data = out;
+    ctx->out_positional = 0;
+
+    return ecu_run(ctx);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer_fd
+ **
+ ** Description     encrypt memory into output fd
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 out_fd : output
+ **                 flags : ECU_OUT_xxx
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer_fd(struct ecu_ctx *ctx, const void *in, size_t len,
+                          int out_fd, unsigned int flags)
+{
+    if( (ctx == NULL) || (out_fd < 0) || ((len > 0) && (in == NULL)) )
+    {
+        return -1;
+    }
+    if( len == 0 )
+    {
+        return 0;
+    }
+
+    ctx->in_fd = -1;
+    ctx->in_data = in;
+    ctx->in_size = len;
+    ctx->out_fd = out_fd;
+    ctx->out_data = NULL;
+    ctx->out_positional = (flags & ECU_OUT_POSITIONAL) ? 1 : 0;
+
+    return ecu_run(ctx);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_batch
+ **
+ ** Description     encrypt many files through one pipeline.
+ **                 files are read one after another and every block is
+ **                 tagged by its file, merger writes each output file in
+ **                 order. no file waits for the pipeline to drain
+ **
+ ** Parameters      ctx : context
+ **                 in_path : input files
+ **                 out_path : output files, created or truncated
+ **                 cnt : number of files
+ **
+ ** Returns         0 is success
+ **                 -1 is error, files after the failed one are not written
+ **
+ *******************************************************************************/
+int ecu_process_batch(struct ecu_ctx *ctx, const char *const *in_path,
+                      const char *const *out_path, unsigned int cnt)
+{
+    int result;
+
+    if( (ctx == NULL) || ((cnt > 0) && ((in_path == NULL) || (out_path == NULL))) )
+    {
+        return -1;
+    }
+    if( cnt == 0 )
+    {
+        return 0;
+    }
+
+    ctx->in_fd = -1;
+    ctx->in_data = NULL;
+    ctx->in_size = 0;
+    ctx->out_fd = -1;
+    ctx->out_data = NULL;
+    ctx->out_positional = 0;
+    ctx->batch_in = in_path;
+    ctx->batch_out = out_path;
+    ctx->batch_cnt = cnt;
+
+    result = ecu_run(ctx);
+
+    ctx->batch_cnt = 0;
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_buffer_at
+ **
+ ** Description     encrypt memory taken from an offset of a stream.
+ **                 keystream of any offset is known without the data
+ **                 before it, so a slice of encrypted stream decrypts alone
+ **
+ ** Parameters      ctx : context
+ **                 in : input data
+ **                 len : length of data
+ **                 offset : offset of in[0] in the stream
+ **                 out : output, len bytes. can be same as in
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_buffer_at(struct ecu_ctx *ctx, const void *in, size_t len,
+                          unsigned long long offset, void *out)
+{
+    const unsigned char *src = in;
+    unsigned char *dst = out;
+    const unsigned char *ks;
+    unsigned int ks_left;
+    unsigned int len_now;
+
+    if( (ctx == NULL) || ((len > 0) && ((in == NULL) || (out == NULL))) )
+    {
+        return -1;
+    }
+
+    /* keystream from an offset in period runs to end of keystream */
+    while( len > 0 )
+    {
+        ks = ecu_get_keystream(ctx, offset);
+        ks_left = ctx->cb.keystream_len - (unsigned int)(offset % ctx->cb.key_period);
+        len_now = (len < ks_left) ? (unsigned int)len : ks_left;
+
+        ecu_xor_block(dst, src, ks, len_now);
+        src += len_now;
+        dst += len_now;
+        len -= len_now;
+        offset += len_now;
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_process_range
+ **
+ ** Description     encrypt a byte range of a seekable input fd into
+ **                 output fd. only the range is read, in calling thread.
+ **                 range past end of input stops at end of input
+ **
+ ** Parameters      ctx : context
+ **                 in_fd : input, regular file or block device
+ **                 offset : first byte of range
+ **                 length : length of range
+ **                 out_fd : output
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_process_range(struct ecu_ctx *ctx, int in_fd, unsigned long long offset,
+                      unsigned long long length, int out_fd)
+{
+    unsigned char *buf;
+    unsigned int buf_size;
+    unsigned int len_now;
+    int result = 0;
+    int len;
+
+    if( (ctx == NULL) || (in_fd < 0) || (out_fd < 0) )
+    {
+        return -1;
+    }
+    if( length == 0 )
+    {
+        return 0;
+    }
+
+    /* small record needs no more than its own size */
+    buf_size = ecu_get_block_size(ctx);
+    if( length < buf_size )
+    {
+        buf_size = (unsigned int)length;
+    }
+    buf = malloc(buf_size);
+    if( buf == NULL )
+    {
+        fprintf(stderr, "range buffer alloc error!\n");
+        return -1;
+    }
+
+    while( length > 0 )
+    {
+        len_now = (length < buf_size) ? (unsigned int)length : buf_size;
+        len = ecu_io_pread(in_fd, buf, len_now, offset);
+        if( len < 0 )
+        {
+            fprintf(stderr, "read error %d\n", errno);
+            result = -1;
+            break;
+        }
+        if( len == 0 )
+        {
+            break;
+        }
+
+        ecu_process_buffer_at(ctx, buf, (size_t)len, offset, buf);
+        if( ecu_io_write(out_fd, buf, (unsigned int)len) )
+        {
+            fprintf(stderr, "write error %d\n", errno);
+            result = -1;
+            break;
+        }
+        offset += (unsigned long long)len;
+        length -= (unsigned long long)len;
+
+        /* end of input */
+        if( (unsigned int)len < len_now )
+        {
+            break;
+        }
+    }
+
+    free(buf);
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_destroy
+ **
+ ** Description     free context
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_destroy(struct ecu_ctx *ctx)
+{
+    if( ctx == NULL )
+    {
+        return;
+    }
+
+    ecu_worker_destroy(&ctx->workers);
+    ecu_enc_destroy(ctx);
+    ecu_ring_destroy(&ctx->dist.rb);
+    ecu_pool_destroy(&ctx->pool);
+    free(ctx->cb.keystream);
+    free(ctx->cb.key);
+    free(ctx);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_run
+ **
+ ** Description     run one stream through threads of context.
+ **                 end of stream goes from distributor through encryptors
+ **                 to merger, every thread returns after it
+ **
+ ** Parameters      ctx : context with input and output of run
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_run(struct ecu_ctx *ctx)
+{
+    off_t base;
+    int result;
+
+    if( ctx->failed )
+    {
+        fprintf(stderr, "context failed before, destroy it\n");
+        return -1;
+    }
+
+    /* memory input size is known, fd input sets it at end of stream */
+    ecu_set_instr_length(ctx, ctx->in_size);
+
+    if( ctx->out_positional )
+    {
+        base = lseek(ctx->out_fd, 0, SEEK_CUR);
+        if( base < 0 )
+        {
+            fprintf(stderr, "positional output should be a regular file\n");
+            return -1;
+        }
+        ctx->out_base = (unsigned long long)base;
+    }
+
+    if( ecu_has_merger(ctx) )
+    {
+        result = ecu_merger_t_start(ctx);
+        if( result )
+        {
+            return -1;
+        }
+    }
+
+    result = ecu_enc_t_start(ctx);
+    if( result )
+    {
+        /* started encryptors are stopped, merger got every end of stream */
+        ctx->failed = 1;
+        if( ecu_has_merger(ctx) )
+        {
+            ecu_merger_t_join(ctx);
+        }
+        return -1;
+    }
+
+    /* memory input needs no distributor */
+    if( ecu_has_dist(ctx) )
+    {
+        result = ecu_dist_t_start(ctx);
+        if( result )
+        {
+            /* let encryptors and merger finish without input */
+            ecu_dist_send_eos(ctx);
+        }
+        else
+        {
+            result = ecu_dist_t_join(ctx);
+        }
+    }
+
+    result |= ecu_enc_t_join(ctx);
+    if( ecu_has_merger(ctx) )
+    {
+        result |= ecu_merger_t_join(ctx);
+    }
+
+    if( result )
+    {
+        /* blocks may be left in flight */
+        ctx->failed = 1;
+        return -1;
+    }
+
+    /* leave output offset after written data as write() does */
+    if( ctx->out_positional )
+    {
+        lseek(ctx->out_fd, ctx->out_base + ecu_get_instr_length(ctx), SEEK_SET);
+    }
+
+#ifdef DEBUG
+    printf("run finished %llu\n", ecu_get_instr_length(ctx));
+#endif
+    return 0;
+}
+
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_key_size
+ **
+ ** Description     Get XOR cryptographic key value
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of key
+ **
+ *******************************************************************************/
+unsigned int ecu_get_key_size(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.key_size;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_block_size
+ **
+ ** Description     Get size of data block for encryptor.
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of block
+ **
+ *******************************************************************************/
+unsigned int ecu_get_block_size(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.block_size;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_read_size
+ **
+ ** Description     Get size of one read() from input stream
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         read size (byte)
+ **
+ *******************************************************************************/
+unsigned int ecu_get_read_size(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.read_size;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_flush_size
+ **
+ ** Description     Get size of output to be flushed at once
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         flush size (byte)
+ **
+ *******************************************************************************/
+unsigned int ecu_get_flush_size(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.flush_size;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_wait_mode
+ **
+ ** Description     Get wait strategy of pipeline threads
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_WAIT_SPIN, ECU_WAIT_HYBRID or ECU_WAIT_BLOCK
+ **
+ *******************************************************************************/
+unsigned int ecu_get_wait_mode(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.wait_mode;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_zero_copy
+ **
+ ** Description     Get whether input is read directly into pipeline blocks
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is zero-copy read
+ **                 0 is chunked read
+ **
+ *******************************************************************************/
+unsigned int ecu_get_zero_copy(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+
+    result = ctx->cb.zero_copy;
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_io_engine
+ **
+ ** Description     Get I/O engine of input and output fd
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_IO_xxx
+ **
+ *******************************************************************************/
+unsigned int ecu_get_io_engine(struct ecu_ctx *ctx)
+{
+    return ctx->cb.io_engine;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_dispatch
+ **
+ ** Description     Get dispatch of blocks to encryptors
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         ECU_ENC_DISPATCH_xxx
+ **
+ *******************************************************************************/
+unsigned int ecu_get_dispatch(struct ecu_ctx *ctx)
+{
+    return ctx->cb.dispatch;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_keystream
+ **
+ ** Description     Get keystream of a block.
+ **                 keystream is built once by ecu_create and shared by all
+ **                 encryptors. block starts at its offset in key period
+ **
+ ** Parameters      ctx : context
+ **                 offset : offset of block in input data
+ **
+ ** Returns         pointer to keystream (block size bytes)
+ **
+ *******************************************************************************/
+const unsigned char *ecu_get_keystream(struct ecu_ctx *ctx, size_t offset)
+{
+    return ctx->cb.keystream + (offset % ctx->cb.key_period);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_set_instr_length
+ **
+ ** Description     Set total size of input data
+ **
+ ** Parameters      ctx : context
+ **                 len : size of input data
+ **
+ ** Returns         0 is success
+ **
+ *******************************************************************************/
+unsigned int ecu_set_instr_length(struct ecu_ctx *ctx, unsigned long long len)
+{
+    /* blocks sent before are visible to whom sees the length */
+    atomic_store_explicit(&ctx->cb.instr_length, len, memory_order_release);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_instr_length
+ **
+ ** Description     Get total size of input data
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         size of input data
+ **
+ *******************************************************************************/
+unsigned long long ecu_get_instr_length(struct ecu_ctx *ctx)
+{
+    unsigned long long result;
+
+    result = atomic_load_explicit(&ctx->cb.instr_length, memory_order_acquire);
+
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_get_num_of_enc_thread
+ **
+ ** Description     Get number of threads for encryption
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         number of thread
+ **
+ *******************************************************************************/
+unsigned int ecu_get_num_of_enc_thread(struct ecu_ctx *ctx)
+{
+    unsigned int result;
+    result = ctx->cb.num_of_enc_thread;
+    return result;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_has_merger
+ **
+ ** Description     check current run writes output through merger.
+ **                 positional and memory output take blocks by offset
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is output through merger
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_has_merger(struct ecu_ctx *ctx)
+{
+    return (ctx->out_positional == 0) && (ctx->out_data == NULL);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_has_dist
+ **
+ ** Description     check current run reads input through distributor.
+ **                 memory input is taken by encryptors by offset
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         1 is input through distributor
+ **                 0 is not
+ **
+ *******************************************************************************/
+int ecu_has_dist(struct ecu_ctx *ctx)
+{
+    return (ctx->in_fd >= 0) || (ctx->batch_cnt > 0);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_set_config
+ **
+ ** Description     check configuration and copy it to control block.
+ **                 0 threads is number of CPUs this process may run on,
+ **                 less distributor and merger
+ **
+ ** Parameters      ctx : context
+ **                 cfg : configuration
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_set_config(struct ecu_ctx *ctx, const struct ecu_config *cfg)
+{
+    unsigned int num, cpu_cnt;
+
+    num = cfg->num_of_enc_thread;
+    if( num == 0 )
+    {
+        cpu_cnt = ecu_cpu_count();
+        num = (cpu_cnt > 2) ? cpu_cnt - 2 : 1;
+        if( num > ECU_ENC_MAX_THREAD_NUM )
+        {
+            num = ECU_ENC_MAX_THREAD_NUM;
+        }
+    }
+    if( num > ECU_ENC_MAX_THREAD_NUM )
+    {
+        fprintf(stderr, "error thread number:%u, 1 to %d\n", num, ECU_ENC_MAX_THREAD_NUM);
+        return -1;
+    }
+    if( (cfg->wait_mode > ECU_WAIT_BLOCK) || (cfg->io_engine > ECU_IO_URING) ||
+        (cfg->dispatch > ECU_ENC_DISPATCH_STEAL) )
+    {
+        fprintf(stderr, "error config wait:%u io:%u dispatch:%u\n",
+                cfg->wait_mode, cfg->io_engine, cfg->dispatch);
+        return -1;
+    }
+    if( cfg->cpus && ecu_cpu_set_list(&ctx->cpus, cfg->cpus) )
+    {
+        fprintf(stderr, "error cpu list:%s\n", cfg->cpus);
+        return -1;
+    }
+
+    ctx->cb.num_of_enc_thread = num;
+    ctx->cb.read_size = cfg->read_size ? cfg->read_size : ECU_DIST_READ_SIZE;
+    ctx->cb.flush_size = cfg->flush_size ? cfg->flush_size : ECU_MERGER_FLUSH_SIZE;
+    ctx->cb.wait_mode = cfg->wait_mode;
+    ctx->cb.zero_copy = cfg->zero_copy ? 1 : 0;
+    ctx->cb.io_engine = cfg->io_engine;
+    ctx->cb.dispatch = cfg->dispatch;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_set_block_size
+ **
+ ** Description     Set size of data block for encryptor.
+ **                 block must hold whole key rotation periods so that
+ **                 every block starts from the original key.
+ **                 period longer than ECU_BLOCK_DEFAULT_SIZE allows any
+ **                 block size, then block starts at its offset in period
+ **
+ ** Parameters      ctx : context
+ **                 size : size of block
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_set_block_size(struct ecu_ctx *ctx, unsigned int size)
+{
+    if( (size == 0) || (size > ECU_BLOCK_MAX_SIZE) ||
+        ((ctx->cb.key_period <= ECU_BLOCK_DEFAULT_SIZE) && (size % ctx->cb.key_period)) )
+    {
+        fprintf(stderr, "error block size:%u, multiple of %u up to %d\n",
+                size, ctx->cb.key_period, ECU_BLOCK_MAX_SIZE);
+        return -1;
+    }
+#ifdef DEBUG
+    printf("Set block size %d\n", size);
+#endif
+    ctx->cb.block_size = size;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_build_keystream
+ **
+ ** Description     Build XOR keystream of one block.
+ **                 key is XORed with every key size bytes of a period
+ **                 and 1-bit shifted left after each use, so a period is
+ **                 the key rotated by 0 to 7 bits.
+ **                 the period is repeated up to keystream length.
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_build_keystream(struct ecu_ctx *ctx)
+{
+    struct encrypt_util_cb *cb = &ctx->cb;
+    unsigned int i;
+    unsigned int key_len;
+    unsigned int done, len;
+
+    key_len = cb->key_size;
+    if( (key_len == 0) || (cb->block_size == 0) )
+    {
+        fprintf(stderr, "invalid key size %d\n", key_len);
+        return -1;
+    }
+
+    /* block not made of whole periods may start anywhere in a period */
+    cb->keystream_len = cb->block_size;
+    if( cb->block_size % cb->key_period )
+    {
+        cb->keystream_len = cb->key_period + cb->block_size;
+    }
+
+    cb->keystream = malloc(cb->keystream_len);
+    if( cb->keystream == NULL )
+    {
+        fprintf(stderr, "keystream alloc error!\n");
+        return -1;
+    }
+
+    for( i = 0 ; i < 8 ; i++ )
+    {
+        ecu_xor_key_rotate(&cb->keystream[i * key_len], cb->key, key_len, i);
+    }
+
+    /* every period starts from the original key.
+     * copied part doubles each time, period is at least 8 bytes
+     */
+    for( done = cb->key_period ; done < cb->keystream_len ; done += len )
+    {
+        len = done;
+        if( len > cb->keystream_len - done )
+        {
+            len = cb->keystream_len - done;
+        }
+        memcpy(&cb->keystream[done], cb->keystream, len);
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_start
+ **
+ ** Description     Allocate block pool.
+ **                 enough blocks to fill both ring buffers, every encryptor
+ **                 and output stage, bounded by reorder buffer size
+ **                 and ECU_POOL_MAX_SIZE. configuration whose minimum
+ **                 blocks do not fit ECU_POOL_MAX_SIZE is an error
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_pool_start(struct ecu_ctx *ctx)
+{
+    struct encrypt_util_cb *cb = &ctx->cb;
+    unsigned int block_num;
+    unsigned int min_num;
+
+    block_num = ECU_DIST_MAX_QUEUE_NUM + ECU_ENC_MAX_QUEUE_NUM
+              + 2 * cb->num_of_enc_thread
+              + cb->flush_size / cb->block_size + 2;
+
+    /* merger holds one flush of blocks being written by io_uring */
+    if( cb->io_engine == ECU_IO_URING )
+    {
+        block_num += cb->flush_size / cb->block_size + 1;
+    }
+
+    /* blocks in flight must fit in reorder buffer of merger */
+    if( block_num > ECU_MERGER_MAX_QUEUE_NUM )
+    {
+        block_num = ECU_MERGER_MAX_QUEUE_NUM;
+    }
+    if( (unsigned long long)block_num * cb->block_size > ECU_POOL_MAX_SIZE )
+    {
+        block_num = ECU_POOL_MAX_SIZE / cb->block_size;
+    }
+
+    /* every encryptor and distributor needs a block to make progress.
+     * round-robin queues of encryptors need at least 3 blocks each
+     */
+    min_num = cb->num_of_enc_thread + 2;
+    if( cb->dispatch == ECU_ENC_DISPATCH_RR )
+    {
+        min_num = cb->num_of_enc_thread * 3 + 2;
+    }
+    if( (unsigned long long)min_num * cb->block_size > ECU_POOL_MAX_SIZE )
+    {
+        fprintf(stderr, "block pool needs %u blocks of %u bytes, over %u bytes. "
+                "use fewer threads or smaller blocks\n",
+                min_num, cb->block_size, ECU_POOL_MAX_SIZE);
+        return -1;
+    }
+    if( block_num < min_num )
+    {
+        block_num = min_num;
+    }
+
+    return ecu_pool_init(&ctx->pool, block_num, cb->block_size, cb->wait_mode);
+}
@@ -4,7 +4,7 @@
 **
 **  Description:    Encryption Utility Main
 **
-** This utility has three parts
+** command line front end of libecu (ecu_lib.c). a stream runs through
 ** - distributor (ecu_dist.c) : read hex data from stdin,
 **                              segment data, send data to encryptor
 ** - encryptor (ecu_enc.c) : encrypt data with key value,
@@ -17,26 +17,48 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <pthread.h>
 #include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
 
 #include "ecu_main.h"
-#include "ecu_dist.h"
-#include "ecu_enc.h"
-#include "ecu_merger.h"
+#include "ecu.h"
+#include "ecu_ctx.h"
+#include "ecu_wait.h"
+#include "ecu_file.h"
+#include "ecu_io.h"
+#include "ecu_serve.h"
+#include "ecu_client.h"
 
 
 /* static function definitions */
-static int ecu_init();
 static void ecu_help();
-static int ecu_set_key_size(unsigned int size);
-static unsigned int ecu_set_block_size(unsigned int size);
-static void ecu_display_key();
-static int ecu_set_num_of_enc_thread(unsigned int num);
-
-
-/* Encryption utility control block */
-struct encrypt_util_cb ENC_CB;
+static unsigned char *ecu_read_key(const char *path, size_t *size);
+static void ecu_display_key(const unsigned char *key, size_t size);
+static int ecu_set_num_of_enc_thread(struct ecu_config *cfg, const char *str);
+static int ecu_parse_size(const char *str, unsigned int *size);
+static int ecu_set_read_size(struct ecu_config *cfg, const char *str);
+static int ecu_set_flush_size(struct ecu_config *cfg, const char *str);
+static int ecu_parse_range(const char *str, unsigned long long *offset,
+                           unsigned long long *length);
+static int ecu_run_range(struct ecu_ctx *ctx, const char *in_file, const char *out_file,
+                         unsigned long long offset, unsigned long long length);
+static int ecu_run_serve(const char *path, const struct ecu_config *cfg);
+static int ecu_run_batch(struct ecu_ctx *ctx, const char *path, const char *out_dir);
+static int ecu_run_connect(const char *path, const char *key_file,
+                           const char *in_file, const char *out_file);
+
+
+/* long options, short ones are in getopt string */
+static const struct option ecu_long_opts[] = {
+    { "range", required_argument, NULL, 'R' },
+    { "serve", required_argument, NULL, 'S' },
+    { "connect", required_argument, NULL, 'C' },
+    { "batch", required_argument, NULL, 'B' },
+    { NULL, 0, NULL, 0 }
+};
 
 
 
@@ -53,106 +75,277 @@ struct encrypt_util_cb ENC_CB;
  *******************************************************************************/
 int main(int argc, char **argv)
 {
-    FILE *fp;
-    int num_of_thread;
+    struct ecu_config cfg;
+    struct ecu_ctx *ctx;
+    unsigned char *key;
+    size_t key_size;
+    int num_set = 0;
     int result;
-    unsigned int key_size;
-
-    if (argc != 5)
-    {
-        printf("error input parameter!\n");
-        ecu_help();
-        return -1;
-    }
-
-    /* init control block */
-    ecu_init();
-
+    int opt;
+    char *key_file = NULL;
+    char *in_file = NULL;
+    char *out_file = NULL;
+    int range_set = 0;
+    unsigned long long range_offset = 0;
+    unsigned long long range_length = 0;
+    char *serve_path = NULL;
+    char *connect_path = NULL;
+    char *batch_path = NULL;
+
+    ecu_config_init(&cfg);
 
     /* process input parameters */
-    if(strcmp(argv[1], "-n") == 0)
+    while( (opt = getopt_long(argc, argv, "n:k:r:w:s:zb:i:o:e:a:d:",
+                              ecu_long_opts, NULL)) != -1 )
     {
-        num_of_thread = atoi(argv[2]);
+        switch(opt)
+        {
+        case 'n':
+            result = ecu_set_num_of_enc_thread(&cfg, optarg);
+            if( result < 0 )
+            {
+                return -1;
+            }
+            num_set = 1;
 #ifdef DEBUG
-        printf("create thread %d\n", num_of_thread);
+            printf("create thread %u\n", cfg.num_of_enc_thread);
 #endif
+            break;
+
+        case 'a':
+            /* checked by ecu_create */
+            cfg.cpus = optarg;
+            break;
+
+        case 'k':
+            key_file = optarg;
+            break;
+
+        case 'r':
+            result = ecu_set_read_size(&cfg, optarg);
+            if( result < 0 )
+            {
+                return -1;
+            }
+            break;
+
+        case 'w':
+            result = ecu_set_flush_size(&cfg, optarg);
+            if( result < 0 )
+            {
+                return -1;
+            }
+            break;
+
+        case 's':
+            result = ecu_wait_parse_mode(optarg);
+            if( result < 0 )
+            {
+                fprintf(stderr, "unknown wait strategy %s\n", optarg);
+                return -1;
+            }
+            cfg.wait_mode = result;
+            break;
+
+        case 'z':
+            cfg.zero_copy = 1;
+            break;
+
+        case 'i':
+            in_file = optarg;
+            break;
+
+        case 'o':
+            out_file = optarg;
+            break;
+
+        case 'e':
+            result = ecu_io_parse_engine(optarg);
+            if( result < 0 )
+            {
+                fprintf(stderr, "unknown I/O engine %s\n", optarg);
+                return -1;
+            }
+            cfg.io_engine = result;
+            break;
+
+        case 'd':
+            result = ecu_enc_parse_dispatch(optarg);
+            if( result < 0 )
+            {
+                fprintf(stderr, "unknown dispatch %s\n", optarg);
+                return -1;
+            }
+            cfg.dispatch = result;
+            break;
+
+        case 'b':
+            /* checked by ecu_create after key size is known */
+            if( ecu_parse_size(optarg, &cfg.block_size) )
+            {
+                fprintf(stderr, "error block size:%s\n", optarg);
+                return -1;
+            }
+            break;
+
+        case 'R':
+            result = ecu_parse_range(optarg, &range_offset, &range_length);
+            if( result < 0 )
+            {
+                fprintf(stderr, "error range:%s, offset:length\n", optarg);
+                return -1;
+            }
+            range_set = 1;
+            break;
+
+        case 'S':
+            serve_path = optarg;
+            break;
+
+        case 'C':
+            connect_path = optarg;
+            break;
+
+        case 'B':
+            batch_path = optarg;
+            break;
+
+        default:
+            ecu_help();
+            return -1;
+        }
+    }
 
-        result = ecu_set_num_of_enc_thread(num_of_thread);
-        if( result < 0 )
+    /* daemon takes keys from clients, every context uses options */
+    if( serve_path )
+    {
+        if( (key_file != NULL) || (optind != argc) )
         {
+            fprintf(stderr, "error input parameter!\n");
+            ecu_help();
             return -1;
         }
+        return ecu_run_serve(serve_path, &cfg) ? 1 : 0;
     }
 
-    if(strcmp(argv[3], "-k") == 0)
+    /* stream is encrypted by daemon */
+    if( connect_path )
     {
-#ifdef DEBUG
-        printf("key file name is %s\n", argv[4]);
-#endif
-        fp = fopen(argv[4], "r");
-        fseek(fp, 0, SEEK_END);
-        key_size = ftell(fp);
-        result = ecu_set_key_size(key_size);
-        if(result < 0)
+        if( (key_file == NULL) || (optind != argc) )
         {
+            fprintf(stderr, "error input parameter!\n");
+            ecu_help();
             return -1;
         }
-        fseek(fp, 0, SEEK_SET);
-        fread(ENC_CB.key, key_size, 1, fp);
-
-        ecu_display_key();
-        ecu_set_block_size(key_size*8);
+        return ecu_run_connect(connect_path, key_file, in_file, out_file) ? 1 : 0;
     }
 
-    /* init mutex for distributor */
-    result = ecu_dist_m_start();
-    if( result )
+    /* batch reads its own input files */
+    if( batch_path && (in_file || range_set) )
     {
-        printf("ecu_dist_m_start error %d\n", result);
+        fprintf(stderr, "error input parameter!\n");
+        ecu_help();
         return -1;
     }
 
-    /* init mutex for encryptor */
-    result = ecu_enc_m_start();
-    if( result )
+    /* range runs in main thread, encryptors are not used */
+    if( range_set && (num_set == 0) )
     {
-        printf("ecu_enc_m_start error %d\n", result);
-        return -1;
+        cfg.num_of_enc_thread = 1;
+        num_set = 1;
     }
 
-    /* start merger thread */
-    result = ecu_merger_t_start();
-    if( result )
+    if( (num_set == 0) || (key_file == NULL) || (optind != argc) )
     {
-        printf("ecu_merger_t_start error %d\n", result);
+        fprintf(stderr, "error input parameter!\n");
+        ecu_help();
         return -1;
     }
 
-    /* start encryptor threads */
-    result = ecu_enc_t_start();
-    if( result )
+    key = ecu_read_key(key_file, &key_size);
+    if( key == NULL )
     {
-        printf("ecu_enc_t_start error %d\n", result);
         return -1;
     }
+    ecu_display_key(key, key_size);
 
-    /* start distributor thread */
-    result = ecu_dist_t_start();
-    if( result )
+    /* key is copied into context */
+    ctx = ecu_create(key, key_size, &cfg);
+    free(key);
+    if( ctx == NULL )
     {
-        printf("ecu_dist_t_start error %d\n", result);
         return -1;
     }
 
-    while(1)
+    if( batch_path )
     {
-#ifdef DEBUG
-        printf("main while loop!\n");
-#endif
-        sleep(1);
+        /* -o is output directory of input directory */
+        result = ecu_run_batch(ctx, batch_path, out_file);
+        ecu_destroy(ctx);
+        return result ? 1 : 0;
     }
 
-    return 0;
+    if( range_set )
+    {
+        /* only the range is read, no pipeline thread is started */
+        result = ecu_run_range(ctx, in_file, out_file, range_offset, range_length);
+        ecu_destroy(ctx);
+        return result ? 1 : 0;
+    }
+
+    if( in_file )
+    {
+        /* encryptors take blocks of mapped file by offset */
+        result = ecu_file_in_open(in_file);
+        if( result )
+        {
+            ecu_destroy(ctx);
+            return -1;
+        }
+    }
+    if( out_file )
+    {
+        /* mapped input is encrypted straight into mapped output,
+         * stdin blocks are written at their offsets
+         */
+        result = ecu_file_out_open(out_file, in_file ? ecu_file_in_get_size() : 0);
+        if( result )
+        {
+            ecu_destroy(ctx);
+            return -1;
+        }
+    }
+
+    if( in_file && out_file )
+    {
+        result = ecu_process_buffer(ctx, ecu_file_in_get_data(),
+                                    ecu_file_in_get_size(), ecu_file_out_get_data());
+    }
+    else if( in_file )
+    {
+        result = ecu_process_buffer_fd(ctx, ecu_file_in_get_data(),
+                                       ecu_file_in_get_size(), STDOUT_FILENO, 0);
+    }
+    else if( out_file )
+    {
+        result = ecu_process_fd(ctx, STDIN_FILENO, ecu_file_out_get_fd(),
+                                ECU_OUT_POSITIONAL);
+    }
+    else
+    {
+        result = ecu_process_fd(ctx, STDIN_FILENO, STDOUT_FILENO, 0);
+    }
+
+    if( out_file )
+    {
+        result |= ecu_file_out_close();
+    }
+    ecu_destroy(ctx);
+
+#ifdef DEBUG
+    printf("main finished %d\n", result);
+#endif
+    return result ? 1 : 0;
 }
 
 
@@ -160,238 +353,470 @@ int main(int argc, char **argv)
 
 /*******************************************************************************
  **
- ** Function        ecu_get_key_size
+ ** Function        ecu_help
  **
- ** Description     Get XOR cryptographic key value
+ ** Description     Display how to use encryptUtil on stderr
  **
- ** Parameters      None
+ ** Parameters      none
  **
- ** Returns         size of key
+ ** Returns         none
  **
  *******************************************************************************/
-unsigned int ecu_get_key_size()
+static void ecu_help()
 {
-    unsigned int result;
-
-    result = ENC_CB.key_size;
-
-    return result;
+    fprintf(stderr, " encryptUtil version 2.0\n");
+    fprintf(stderr, "usage\n");
+    fprintf(stderr, " encryptUtil [-n #] [-k keyfile] [-r bytes] [-w bytes] [-s wait] [-b bytes] [-z] [-i file] [-o file] [-e engine] [-a cpus] [-d dispatch] [--range offset:length] [--serve socket] [--connect socket] [--batch list|dir]\n");
+    fprintf(stderr, " -n # Number of threads to create, or auto. %d is maximum\n", ECU_ENC_MAX_THREAD_NUM);
+    fprintf(stderr, " -k keyfile Path to file containing key, up to %d bytes\n", ECU_KEY_MAX);
+    fprintf(stderr, " -r bytes Size of one read from stdin. default %d\n", ECU_DIST_READ_SIZE);
+    fprintf(stderr, " -w bytes Output is flushed to stdout every this size. default %d\n", ECU_MERGER_FLUSH_SIZE);
+    fprintf(stderr, " -s wait Wait strategy of threads, spin|hybrid|block. default hybrid\n");
+    fprintf(stderr, " -b bytes Size of data block, multiple of key size x 8 for keys up to %d bytes. default about %d\n", ECU_BLOCK_DEFAULT_SIZE / 8, ECU_BLOCK_DEFAULT_SIZE);
+    fprintf(stderr, " -z Zero-copy, read stdin directly into blocks encrypted in place\n");
+    fprintf(stderr, " -i file Read regular file by mmap instead of stdin\n");
+    fprintf(stderr, " -o file Write each block at its offset of file instead of stdout\n");
+    fprintf(stderr, " -a cpus Pin distributor, merger, then encryptors to cpus, like 0-3,8 or auto\n");
+    fprintf(stderr, " -d dispatch Blocks to encryptors, shared|rr|steal. default shared\n");
+    fprintf(stderr, " -e engine I/O engine of stdin/stdout, sync|splice|uring. default sync\n");
+    fprintf(stderr, " --range offset:length Encrypt only this byte range of seekable input\n");
+    fprintf(stderr, " --serve socket Run daemon on Unix socket, keys come from clients\n");
+    fprintf(stderr, " --batch list|dir Encrypt files of list (input output per line), or of directory into -o directory\n");
+    fprintf(stderr, " --connect socket Encrypt stdin through daemon on Unix socket\n");
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_copy_key
+ ** Function        ecu_parse_range
  **
- ** Description     Copy XOR cryptographic key value to input pointer
+ ** Description     parse byte range "offset:length", each decimal, 0x hex
+ **                 or 0 octal. missing digits, trailing characters and
+ **                 overflow of either number or of their sum are errors
  **
- ** Parameters      destination pointer
+ ** Parameters      str : range
+ **                 offset : first byte of range
+ **                 length : length of range
  **
- ** Returns         none
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-void ecu_copy_key(unsigned char *dest)
+static int ecu_parse_range(const char *str, unsigned long long *offset,
+                           unsigned long long *length)
 {
-    memcpy(dest, ENC_CB.key, ENC_CB.key_size);
-}
+    char *end;
 
+    if( (*str < '0') || (*str > '9') )
+    {
+        return -1;
+    }
+    errno = 0;
+    *offset = strtoull(str, &end, 0);
+    if( (end == str) || (*end != ':') || (errno == ERANGE) )
+    {
+        return -1;
+    }
+
+    str = end + 1;
+    if( (*str < '0') || (*str > '9') )
+    {
+        return -1;
+    }
+    errno = 0;
+    *length = strtoull(str, &end, 0);
+    if( (end == str) || (*end != '\0') || (errno == ERANGE) ||
+        (*length > ULLONG_MAX - *offset) )
+    {
+        return -1;
+    }
+
+    return 0;
+}
 
 
 /*******************************************************************************
  **
- ** Function        ecu_get_block_size
+ ** Function        ecu_run_range
  **
- ** Description     Get size of data block for encryptor.
+ ** Description     encrypt a byte range of input file, or of stdin
+ **                 redirected from a file, into stdout or output file
  **
- ** Parameters      none
+ ** Parameters      ctx : context
+ **                 in_file : input file, NULL is stdin
+ **                 out_file : output file, NULL is stdout
+ **                 offset : first byte of range
+ **                 length : length of range
  **
- ** Returns         size of block
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-unsigned int ecu_get_block_size()
+static int ecu_run_range(struct ecu_ctx *ctx, const char *in_file, const char *out_file,
+                         unsigned long long offset, unsigned long long length)
 {
-    unsigned int result;
+    int in_fd = STDIN_FILENO;
+    int out_fd = STDOUT_FILENO;
+    int result;
 
-    result = ENC_CB.block_size;
+    if( in_file )
+    {
+        in_fd = open(in_file, O_RDONLY);
+        if( in_fd < 0 )
+        {
+            fprintf(stderr, "cannot open input file %s\n", in_file);
+            return -1;
+        }
+    }
+    if( out_file )
+    {
+        result = ecu_file_out_open(out_file, 0);
+        if( result )
+        {
+            if( in_file )
+            {
+                close(in_fd);
+            }
+            return -1;
+        }
+        out_fd = ecu_file_out_get_fd();
+    }
+
+    result = ecu_process_range(ctx, in_fd, offset, length, out_fd);
 
+    if( out_file )
+    {
+        result |= ecu_file_out_close();
+    }
+    if( in_file )
+    {
+        close(in_fd);
+    }
     return result;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_set_instr_length
+ ** Function        ecu_run_batch
  **
- ** Description     Set total size of input data
+ ** Description     encrypt every file pair of list file or directory
+ **                 through one pipeline
  **
- ** Parameters      size of input data
+ ** Parameters      ctx : context
+ **                 path : list file or input directory
+ **                 out_dir : output directory of input directory
  **
  ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-unsigned int ecu_set_instr_length(unsigned int len)
+static int ecu_run_batch(struct ecu_ctx *ctx, const char *path, const char *out_dir)
 {
-    ENC_CB.instr_length = len;
+    int result;
 
-    return 0;
+    result = ecu_file_batch_open(path, out_dir);
+    if( result )
+    {
+        return -1;
+    }
+
+#ifdef DEBUG
+    printf("batch of %u files\n", ecu_file_batch_get_cnt());
+#endif
+    result = ecu_process_batch(ctx, ecu_file_batch_get_in(), ecu_file_batch_get_out(),
+                               ecu_file_batch_get_cnt());
+
+    ecu_file_batch_close();
+    return result;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_get_instr_length
+ ** Function        ecu_run_serve
  **
- ** Description     Get total size of input data
+ ** Description     check options with a context of dummy key,
+ **                 then run daemon
  **
- ** Parameters      none
+ ** Parameters      path : Unix socket
+ **                 cfg : configuration of every context
  **
- ** Returns         size of input data
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-unsigned int ecu_get_instr_length()
+static int ecu_run_serve(const char *path, const struct ecu_config *cfg)
 {
-    unsigned int result;
+    struct ecu_ctx *ctx;
+    unsigned char key = 0;
 
-    result = ENC_CB.instr_length;
+    /* block size may not fit key of a client, it is checked per stream */
+    ctx = ecu_create(&key, sizeof(key), cfg);
+    if( ctx == NULL )
+    {
+        return -1;
+    }
+    ecu_destroy(ctx);
 
-    return result;
+    return ecu_serve(path, cfg);
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_get_num_of_enc_thread
+ ** Function        ecu_run_connect
  **
- ** Description     Get number of threads for encryption
+ ** Description     encrypt stdin or input file into stdout or output file
+ **                 through daemon
  **
- ** Parameters      none
+ ** Parameters      path : Unix socket of daemon
+ **                 key_file : key file
+ **                 in_file : input file, NULL is stdin
+ **                 out_file : output file, NULL is stdout
  **
- ** Returns         number of thread
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-unsigned int ecu_get_num_of_enc_thread()
+static int ecu_run_connect(const char *path, const char *key_file,
+                           const char *in_file, const char *out_file)
 {
-    unsigned int result;
-    result = ENC_CB.num_of_enc_thread;
+    unsigned char *key;
+    size_t key_size;
+    int in_fd = STDIN_FILENO;
+    int out_fd = STDOUT_FILENO;
+    int result;
+
+    key = ecu_read_key(key_file, &key_size);
+    if( key == NULL )
+    {
+        return -1;
+    }
+
+    if( in_file )
+    {
+        in_fd = open(in_file, O_RDONLY);
+        if( in_fd < 0 )
+        {
+            fprintf(stderr, "cannot open input file %s\n", in_file);
+            free(key);
+            return -1;
+        }
+    }
+    if( out_file )
+    {
+        result = ecu_file_out_open(out_file, 0);
+        if( result )
+        {
+            if( in_file )
+            {
+                close(in_fd);
+            }
+            free(key);
+            return -1;
+        }
+        out_fd = ecu_file_out_get_fd();
+    }
+
+    result = ecu_client_process_fd(path, key, key_size, in_fd, out_fd);
+
+    if( out_file )
+    {
+        result |= ecu_file_out_close();
+    }
+    if( in_file )
+    {
+        close(in_fd);
+    }
+    free(key);
     return result;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_init
+ ** Function        ecu_read_key
  **
- ** Description     Initialize Encryptor util Control Block
+ ** Description     read key file into memory
  **
- ** Parameters      none
+ ** Parameters      path : key file
+ **                 size : size of key
  **
- ** Returns         status
+ ** Returns         key, caller frees it
+ **                 NULL is error
  **
  *******************************************************************************/
-static int ecu_init()
+static unsigned char *ecu_read_key(const char *path, size_t *size)
 {
+    FILE *fp;
+    long key_size;
+    unsigned char *key;
+
 #ifdef DEBUG
-    printf("ecu_init!\n");
+    printf("key file name is %s\n", path);
 #endif
-    memset(&ENC_CB, sizeof(struct encrypt_util_cb), 0);
+    fp = fopen(path, "r");
+    if( fp == NULL )
+    {
+        fprintf(stderr, "cannot open key file %s\n", path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    key_size = ftell(fp);
+    if( (key_size <= 0) || (key_size > ECU_KEY_MAX) )
+    {
+        fprintf(stderr, "Key size should be 1 to %d! %ld\n", ECU_KEY_MAX, key_size);
+        fclose(fp);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_SET);
+    key = malloc(key_size);
+    if( (key == NULL) || (fread(key, key_size, 1, fp) != 1) )
+    {
+        fprintf(stderr, "cannot read key file %s\n", path);
+        free(key);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
 
-    return 0;
+    *size = (size_t)key_size;
+    return key;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_help
+ ** Function        ecu_display_key
  **
- ** Description     Display how to use encryptUtil
+ ** Description     print key value for debugging
  **
- ** Parameters      none
+ ** Parameters      key : key data
+ **                 size : size of key
  **
  ** Returns         none
  **
  *******************************************************************************/
-static void ecu_help()
+static void ecu_display_key(const unsigned char *key, size_t size)
 {
-    printf(" encryptUtil version 2.0\n");
-    printf("usage\n");
-    printf(" encryptUtil [-n #] [-k keyfile]\n");
-    printf(" -n # Number of threads to create. 10 is maximum\n");
-    printf(" -k keyfile Path to file containing key\n");
+#ifdef DEBUG
+    size_t i;
+
+    printf("\n");
+    for(i=0;i<size;i++)
+    {
+        printf("%02X ", key[i]);
+    }
+    printf("\n");
+#else
+    (void)key;
+    (void)size;
+#endif
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_set_key_size
+ ** Function        ecu_set_num_of_enc_thread
  **
- ** Description     Set XOR cryptographic key value
+ ** Description     Set number of threads for encryption.
+ **                 auto is 0, ecu_create takes number of CPUs this
+ **                 process may run on, less distributor and merger
  **
- ** Parameters      size of key
+ ** Parameters      cfg : configuration
+ **                 str : number of thread or "auto"
  **
- ** Returns         0 is okay, -1 is error.
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-static int ecu_set_key_size(unsigned int size)
+static int ecu_set_num_of_enc_thread(struct ecu_config *cfg, const char *str)
 {
-    if(size > ECU_KEY_MAX)
+    char *end;
+    long num;
+
+    if( strcmp(str, "auto") == 0 )
     {
-        printf("Key size is too big! %d\n", size);
+        cfg->num_of_enc_thread = 0;
+        return 0;
+    }
+
+    num = strtol(str, &end, 10);
+    if( (end == str) || (*end != '\0') || (num < 1) || (num > ECU_ENC_MAX_THREAD_NUM) )
+    {
+        fprintf(stderr, "error thread number:%s, 1 to %d or auto\n", str, ECU_ENC_MAX_THREAD_NUM);
         return -1;
     }
-#ifdef DEBUG
-    printf("Set Key size %d\n", size);
-#endif
-    ENC_CB.key_size = size;
+    cfg->num_of_enc_thread = (unsigned int)num;
+
     return 0;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_display_key
+ ** Function        ecu_parse_size
  **
- ** Description     print key value for debugging
+ ** Description     parse a size in bytes, decimal, 0x hex or 0 octal.
+ **                 trailing characters, 0 and overflow are errors
  **
- ** Parameters      none
+ ** Parameters      str : size string
+ **                 size : parsed size
  **
- ** Returns         none
+ ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-static void ecu_display_key()
+static int ecu_parse_size(const char *str, unsigned int *size)
 {
-#ifdef DEBUG
-    unsigned int i;
+    unsigned long long num;
+    char *end;
 
-    printf("\n");
-    for(i=0;i<ENC_CB.key_size;i++)
+    if( (*str < '0') || (*str > '9') )
     {
-        printf("%02X ", ENC_CB.key[i]);
+        return -1;
     }
-    printf("\n");
-#endif
+
+    errno = 0;
+    num = strtoull(str, &end, 0);
+    if( (end == str) || (*end != '\0') || (errno == ERANGE) ||
+        (num == 0) || (num > UINT_MAX) )
+    {
+        return -1;
+    }
+    *size = (unsigned int)num;
+
+    return 0;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_set_num_of_enc_thread
+ ** Function        ecu_set_read_size
  **
- ** Description     Set number of threads for encryption
+ ** Description     Set size of one read() from input stream
  **
- ** Parameters      number of thread
+ ** Parameters      cfg : configuration
+ **                 str : read size (byte)
  **
  ** Returns         0 is success
  **                 -1 is error
  **
  *******************************************************************************/
-static int ecu_set_num_of_enc_thread(unsigned int num)
+static int ecu_set_read_size(struct ecu_config *cfg, const char *str)
 {
-    if (num > ECU_ENC_MAX_THREAD_NUM)
+    unsigned int size;
+
+    if( ecu_parse_size(str, &size) )
     {
-        printf("error thread number:%d\n", num);
+        fprintf(stderr, "error read size:%s\n", str);
         return -1;
     }
-    ENC_CB.num_of_enc_thread = num;
+#ifdef DEBUG
+    printf("Set read size %u\n", size);
+#endif
+    cfg->read_size = size;
 
     return 0;
 }
@@ -399,21 +824,30 @@ static int ecu_set_num_of_enc_thread(unsigned int num)
 
 /*******************************************************************************
  **
- ** Function        ecu_set_block_size
+ ** Function        ecu_set_flush_size
  **
- ** Description     Set size of data block for encryptor.
+ ** Description     Set size of output to be flushed at once
  **
- ** Parameters      size of block
+ ** Parameters      cfg : configuration
+ **                 str : flush size (byte)
  **
  ** Returns         0 is success
+ **                 -1 is error
  **
  *******************************************************************************/
-static unsigned int ecu_set_block_size(unsigned int size)
+static int ecu_set_flush_size(struct ecu_config *cfg, const char *str)
 {
+    unsigned int size;
+
+    if( ecu_parse_size(str, &size) )
+    {
+        fprintf(stderr, "error flush size:%s\n", str);
+        return -1;
+    }
 #ifdef DEBUG
-    printf("Set block size %d\n", size);
+    printf("Set flush size %u\n", size);
 #endif
-    ENC_CB.block_size = size;
+    cfg->flush_size = size;
 
     return 0;
 }
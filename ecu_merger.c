@@ -3,39 +3,42 @@
 **  Name:           ecu_merger.c
 **
 **  Description:    reorder encrypted block from encryption buffers.
-**                  print out to stdio
+**                  print out to output fd
 **  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
 *****************************************************************************/
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 
-#include "ecu_main.h"
+#include "ecu_ctx.h"
 #include "ecu_dist.h"
 #include "ecu_enc.h"
 #include "ecu_merger.h"
-
-static pthread_t ecu_merger_tid;
-
-/* reorder queue to print out block as sequence number order */
-struct ecu_merger_msg ECU_MERGER_REODER_Q[ECU_MERGER_MAX_QUEUE_NUM];
-
-extern struct enc_queue_ipc ECU_ENC_RB_IPC;
-
+#include "ecu_ring.h"
+#include "ecu_wait.h"
+#include "ecu_pool.h"
+#include "ecu_io.h"
+#include "ecu_uring.h"
+#include "ecu_cpu.h"
 
 /* define static functions */
 static void *ecu_merger_thread(void *ptr);
-static int ecu_merger_execute(struct ecu_enc_msg *enc_msg);
-static int ecu_merger_search_reorder_buffer(unsigned int seq_num);
-static int ecu_merger_save_msg_reorder_buffer(struct ecu_enc_msg *enc_msg);
-
-
-
-
-static unsigned int seq_out = 0; /* expected sequence number */
-static unsigned int rcv_cnt = 0; /* received block counter */
+static int ecu_merger_execute(struct ecu_ctx *ctx, struct ecu_block *blk);
+static unsigned int ecu_merger_drain_reorder_buffer(struct ecu_ctx *ctx);
+static int ecu_merger_save_msg_reorder_buffer(struct ecu_ctx *ctx, struct ecu_block *blk);
+static void ecu_merger_out_block(struct ecu_ctx *ctx, struct ecu_block *blk);
+static void ecu_merger_out_file(struct ecu_ctx *ctx, unsigned int file_id);
+static int ecu_merger_flush(struct ecu_ctx *ctx);
+static struct ecu_block *ecu_merger_wait_block(struct ecu_ctx *ctx);
+static void ecu_merger_uring_write(struct ecu_ctx *ctx);
+static void ecu_merger_uring_wait(struct ecu_ctx *ctx, unsigned int left);
+static struct ecu_block *ecu_merger_pop_block(struct ecu_ctx *ctx);
 
 
 
@@ -44,45 +47,67 @@ static unsigned int rcv_cnt = 0; /* received block counter */
  ** Function        ecu_merger_thread
  **
  ** Description     merge thread function
- **                 reorder encrypted block and print out to stdio
+ **                 reorder encrypted block and print out to output fd
  **
- ** Parameters
+ ** Parameters      ptr : context
  **
  ** Returns         void
  **
  *******************************************************************************/
 static void *ecu_merger_thread(void *ptr)
 {
-    struct ecu_enc_msg *enc_msg;
-    unsigned int q_cnt;
+    struct ecu_ctx *ctx = ptr;
+    struct ecu_merger *m = &ctx->merger;
+    struct ecu_block *blk;
+    unsigned int eos_cnt, eos_num;
+
+    /* every encryptor sends end of stream after its last block.
+     * round-robin merger meets it only when every block is merged
+     */
+    eos_num = ecu_get_num_of_enc_thread(ctx);
+    if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
+    {
+        eos_num = 1;
+    }
+    eos_cnt = 0;
 
-    while(1)
+    while( eos_cnt < eos_num )
     {
-        pthread_mutex_lock(&ECU_ENC_RB_IPC.lock);
-        q_cnt = ecu_enc_get_block_cnt_in_rb();
-#ifdef DEBUG
-        printf("merger q_cnt:%d\n", q_cnt);
-#endif
-        if(q_cnt > 0)
+        blk = ecu_merger_pop_block(ctx);
+        if(blk == NULL)
         {
-#ifdef DEBUG
-            printf("merger q_cnt:%d\n", q_cnt);
-#endif
-            enc_msg = ecu_enc_pop_block();
-            pthread_mutex_unlock(&ECU_ENC_RB_IPC.lock);
-
-            if(enc_msg)
-            {
-                /* check seq number and print out to stdout */
-                ecu_merger_execute(enc_msg);
-            }
+            /* nothing to merge, do not hold output while idle */
+            ecu_merger_flush(ctx);
+            ecu_merger_uring_wait(ctx, 0);
+            blk = ecu_merger_wait_block(ctx);
         }
-        else
+        if( blk == &ECU_BLOCK_EOS )
         {
-            pthread_mutex_unlock(&ECU_ENC_RB_IPC.lock);
-            usleep(1000);
+            eos_cnt++;
         }
+        else if(blk)
+        {
+#ifdef DEBUG
+            printf("merger seq:%llu\n", blk->seq_num);
+#endif
+            /* check seq number and print out to output fd */
+            ecu_merger_execute(ctx, blk);
+        }
+    }
+
+    /* every block is received, so reorder buffer is already empty */
+    ecu_merger_flush(ctx);
+    ecu_merger_uring_wait(ctx, 0);
+    if( ctx->batch_cnt )
+    {
+        ecu_merger_out_file(ctx, ctx->batch_cnt);
+    }
+    if( m->out_uring )
+    {
+        ecu_uring_exit(&m->out_ring);
     }
+
+    return NULL;
 }
 
 
@@ -92,30 +117,147 @@ static void *ecu_merger_thread(void *ptr)
  **
  ** Description     create merger thread
  **
- ** Parameters
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 the others are errors
  **
  *******************************************************************************/
-int ecu_merger_t_start()
+int ecu_merger_t_start(struct ecu_ctx *ctx)
 {
+    struct ecu_merger *m = &ctx->merger;
     int result;
 #ifdef DEBUG
     printf("ecu_merger_t_start\n");
 #endif
 
-    memset(ECU_MERGER_REODER_Q, sizeof(struct ecu_merger_msg)*ECU_MERGER_MAX_QUEUE_NUM, 0);
-    result = pthread_create(&ecu_merger_tid, NULL, ecu_merger_thread, NULL);
+    memset(m->reorder_q, 0, sizeof(m->reorder_q));
+    m->result = 0;
+    m->seq_out = 0;
+    m->out_iov_cnt = 0;
+    m->out_pending = 0;
+    m->out_uring = 0;
+    m->out_offset = 0;
+    m->out_fd = ctx->out_fd;
+    m->out_file = 0;
+
+    /* batch output files are opened by merger and written with writev() */
+    if( ctx->batch_cnt )
+    {
+        m->out_fd = -1;
+    }
+
+    /* whole flush fits in output pipe, one writev() per reader wakeup */
+    if( (ecu_get_io_engine(ctx) == ECU_IO_SPLICE) && (ctx->batch_cnt == 0) )
+    {
+        ecu_io_pipe_grow(ctx->out_fd, ecu_get_flush_size(ctx));
+    }
+
+    /* append mode ignores offset, such output is written in order */
+    if( (ecu_get_io_engine(ctx) == ECU_IO_URING) && (ctx->batch_cnt == 0) &&
+        ecu_io_is_file(ctx->out_fd, 1) &&
+        (ecu_uring_init(&m->out_ring, ECU_URING_DEPTH) == 0) )
+    {
+        ecu_uring_register(&m->out_ring, ctx->pool.arena, ctx->pool.arena_size);
+        m->out_offset = lseek(ctx->out_fd, 0, SEEK_CUR);
+        m->out_uring = 1;
+    }
+    result = ecu_worker_create(&ctx->workers, &m->tid, ecu_merger_thread, ctx);
     if(result)
     {
-        printf("pthread_create error!!");
+        fprintf(stderr, "pthread_create error!!\n");
+        if( m->out_uring )
+        {
+            ecu_uring_exit(&m->out_ring);
+        }
+        return result;
     }
+    ecu_cpu_pin(&ctx->cpus, m->tid, ECU_CPU_MERGER);
 
     return result;
 }
 
 
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_t_join
+ **
+ ** Description     wait for merger thread to write out whole stream.
+ **                 end of stream markers merger did not take are dropped
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if output failed
+ **
+ *******************************************************************************/
+int ecu_merger_t_join(struct ecu_ctx *ctx)
+{
+    unsigned int i;
+
+    ecu_worker_join(&ctx->workers, ctx->merger.tid);
+
+    /* round-robin merger stops at first end of stream,
+     * the other encryptors have theirs left in output queue
+     */
+    for( i = 0 ; i < ctx->enc.q_num ; i++ )
+    {
+        while( ecu_spsc_pop(&ctx->enc.out_q[i]) )
+        {
+        }
+    }
+
+    return ctx->merger.result;
+}
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_wait_block
+ **
+ ** Description     wait for encrypted block while merger is idle
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         encrypted block or end of stream marker
+ **                 NULL if woken up without block
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_merger_wait_block(struct ecu_ctx *ctx)
+{
+    /* round-robin dispatch, next block comes from encryptor seq_out % N */
+    if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
+    {
+        return ecu_spsc_pop_wait(ecu_enc_get_out_q(ctx, ctx->merger.seq_out));
+    }
+    return ecu_ring_pop_wait(&ctx->enc.rb);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_pop_block
+ **
+ ** Description     pop encrypted block without waiting.
+ **                 round-robin dispatch pops encryptor of seq_out,
+ **                 so blocks come already in order
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         encrypted block
+ **                 NULL if none
+ **
+ *******************************************************************************/
+static struct ecu_block *ecu_merger_pop_block(struct ecu_ctx *ctx)
+{
+    if( ecu_get_dispatch(ctx) == ECU_ENC_DISPATCH_RR )
+    {
+        return ecu_spsc_pop(ecu_enc_get_out_q(ctx, ctx->merger.seq_out));
+    }
+    return ecu_enc_pop_block(ctx);
+}
+
 
 /*******************************************************************************
  **
@@ -124,142 +266,356 @@ int ecu_merger_t_start()
  ** Description     check seq number
  **                 if seq is corrct, print
  **                 if not, save to reorder buffer
+ **                 then print every following block ready in reorder buffer
  **
- ** Parameters      encrypted block
+ ** Parameters      ctx : context
+ **                 blk : encrypted block
  **
  ** Returns         0 is success
  **
  *******************************************************************************/
-static int ecu_merger_execute(struct ecu_enc_msg *enc_msg)
+static int ecu_merger_execute(struct ecu_ctx *ctx, struct ecu_block *blk)
 {
-    unsigned int i;
-    unsigned char *data;
-    unsigned int total_size, total_in_size;
-    unsigned int block_size;
-
-    data = enc_msg->p_enc_data;
-
 #ifdef DEBUG
-    printf("seq : 0x%x\n", enc_msg->seq_num);
+    printf("seq : 0x%llx\n", blk->seq_num);
 #endif
+
     /* compare seqeunce number */
-    if (enc_msg->seq_num == seq_out) /* if seq num is correct, print stdout */
+    if (blk->seq_num == ctx->merger.seq_out) /* if seq num is correct, print out */
     {
-        for( i=0 ; i < enc_msg->data_len ; i++ )
-        {
-            printf("%c", data[i]);
-        }
-        free(data);
-        seq_out++;
+        ecu_merger_out_block(ctx, blk);
+        ctx->merger.seq_out++;
     }
     else
     {
         /* save disordered msg to reorder buffer */
-        ecu_merger_save_msg_reorder_buffer(enc_msg);
-        /* search reorder buffer */
-        ecu_merger_search_reorder_buffer(seq_out);
+        ecu_merger_save_msg_reorder_buffer(ctx, blk);
     }
 
-    rcv_cnt++;
-    total_in_size = ecu_get_instr_length();
+    /* print out blocks waiting in reorder buffer as long as in order */
+    ecu_merger_drain_reorder_buffer(ctx);
 
-#ifdef DEBUG
-    printf("total_size : %d\n", total_size);
-#endif
+    return 0;
+}
 
-    if( total_in_size > 0 )
-    {
-        block_size = ecu_get_block_size();
-        total_size = rcv_cnt * block_size;
 
-        /* if we have whole data from distributor, exit program */
-        if( (total_size == total_in_size) ||
-            (total_size + block_size > total_in_size) )
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_drain_reorder_buffer
+ **
+ ** Description     print out blocks in reorder buffer from seq_out
+ **                 until a block is missing
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         number of printed blocks
+ **
+ *******************************************************************************/
+static unsigned int ecu_merger_drain_reorder_buffer(struct ecu_ctx *ctx)
+{
+    struct ecu_merger *m = &ctx->merger;
+    struct ecu_block **slot;
+    unsigned int cnt = 0;
+
+    while(1)
+    {
+        slot = &m->reorder_q[m->seq_out & (ECU_MERGER_MAX_QUEUE_NUM - 1)];
+        if( *slot == NULL )
         {
-            /* if we have reminder in reorder buffer, print all out */
-            while( seq_out < rcv_cnt )
-            {
-                ecu_merger_search_reorder_buffer(seq_out);
-            }
-            exit(1);
+            break;
         }
+        ecu_merger_out_block(ctx, *slot);
+        *slot = NULL;
+        m->seq_out++;
+        cnt++;
     }
+    return cnt;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_save_msg_reorder_buffer
+ **
+ ** Description     save a block to reorder buffer.
+ **                 slot is indexed by seq number modulo reorder buffer size
+ **
+ ** Parameters      ctx : context
+ **                 blk : block pointer
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_merger_save_msg_reorder_buffer(struct ecu_ctx *ctx, struct ecu_block *blk)
+{
+    struct ecu_block **slot;
+
+    slot = &ctx->merger.reorder_q[blk->seq_num & (ECU_MERGER_MAX_QUEUE_NUM - 1)];
+    if( *slot )
+    {
+        /* block pool is not bigger than reorder buffer, cannot be happened */
+        fprintf(stderr, "reorder buffer overflowed!! seq:%llu\n", blk->seq_num);
+        ctx->merger.result = -1;
+        ecu_pool_put(&ctx->pool, blk);
+        return -1;
+    }
+    *slot = blk;
+
     return 0;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_merger_search_reorder_buffer
+ ** Function        ecu_merger_out_block
+ **
+ ** Description     add an in-order block to output stage.
+ **                 output stage owns the block and puts it back to pool
+ **                 after write.
+ **                 flush if flush size is reached or iovec is full
+ **
+ ** Parameters      ctx : context
+ **                 blk : encrypted block
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_merger_out_block(struct ecu_ctx *ctx, struct ecu_block *blk)
+{
+    struct ecu_merger *m = &ctx->merger;
+
+    /* blocks of batch come file after file */
+    if( ctx->batch_cnt && ((m->out_fd < 0) || (blk->file_id != m->out_file)) )
+    {
+        ecu_merger_out_file(ctx, blk->file_id);
+    }
+
+    m->out_blk[m->out_iov_cnt] = blk;
+    m->out_iov[m->out_iov_cnt].iov_base = blk->p_data;
+    m->out_iov[m->out_iov_cnt].iov_len = blk->data_len;
+    m->out_iov_cnt++;
+    m->out_pending += blk->data_len;
+
+    if( (m->out_pending >= ecu_get_flush_size(ctx)) ||
+        (m->out_iov_cnt == ECU_MERGER_MAX_IOV) )
+    {
+        ecu_merger_flush(ctx);
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_out_file
+ **
+ ** Description     switch output to another file of batch.
+ **                 blocks of current file are written and the file is
+ **                 closed. after an error no file is opened
+ **
+ ** Parameters      ctx : context
+ **                 file_id : file of next block, batch count closes last one
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_merger_out_file(struct ecu_ctx *ctx, unsigned int file_id)
+{
+    struct ecu_merger *m = &ctx->merger;
+
+    ecu_merger_flush(ctx);
+
+    /* delayed write error of file system shows up at close */
+    if( (m->out_fd >= 0) && close(m->out_fd) )
+    {
+        fprintf(stderr, "close error %d\n", errno);
+        m->result = -1;
+    }
+    m->out_fd = -1;
+    m->out_file = file_id;
+
+    if( (file_id >= ctx->batch_cnt) || m->result )
+    {
+        return;
+    }
+
+    m->out_fd = open(ctx->batch_out[file_id], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if( m->out_fd < 0 )
+    {
+        fprintf(stderr, "cannot open output file %s\n", ctx->batch_out[file_id]);
+        m->result = -1;
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_flush
  **
- ** Description     search block having seq number
+ ** Description     write all blocks in output stage to output fd
+ **                 with writev() and put them back to pool
  **
- ** Parameters      sequence number to find
+ ** Parameters      ctx : context
  **
  ** Returns         0 is success
  **                 -1 is error
  **
  *******************************************************************************/
-static int ecu_merger_search_reorder_buffer(unsigned int seq_num)
+static int ecu_merger_flush(struct ecu_ctx *ctx)
 {
-    unsigned int i, j;
-    unsigned char *data;
+    struct ecu_merger *m = &ctx->merger;
+    struct iovec *iov;
+    unsigned int iov_cnt;
+    unsigned int i;
+    ssize_t len;
+    int result = 0;
+
+    if( m->out_uring )
+    {
+        ecu_merger_uring_write(ctx);
+        return 0;
+    }
 
-    for (i=0;i<ECU_MERGER_MAX_QUEUE_NUM;i++)
+    iov = m->out_iov;
+    iov_cnt = m->out_iov_cnt;
+    /* after write error, the rest of stream is dropped */
+    while( (iov_cnt > 0) && (m->result == 0) )
     {
-        if((ECU_MERGER_REODER_Q[i].in_use == 1) && (ECU_MERGER_REODER_Q[i].seq_num == seq_num))
+        len = writev(m->out_fd, iov, iov_cnt);
+        if( len < 0 )
         {
-            data = ECU_MERGER_REODER_Q[i].p_enc_data;
-            for (j = 0;j<ECU_MERGER_REODER_Q[i].data_len;j++)
+            if( errno == EINTR )
             {
-                printf("%c", data[j]);
+                continue;
             }
-            ECU_MERGER_REODER_Q[i].in_use = 0;
-            free(ECU_MERGER_REODER_Q[i].p_enc_data);
-            seq_out++;
+            fprintf(stderr, "write error %d\n", errno);
+            m->result = -1;
+            result = -1;
+            break;
+        }
 
-            return 0;
+        /* skip fully written blocks, adjust partially written one */
+        while( (iov_cnt > 0) && ((size_t)len >= iov->iov_len) )
+        {
+            len -= iov->iov_len;
+            iov++;
+            iov_cnt--;
         }
+        if( iov_cnt > 0 )
+        {
+            iov->iov_base = (unsigned char *)iov->iov_base + len;
+            iov->iov_len -= len;
+        }
+    }
+
+    /* blocks were written, give them back to pool */
+    for( i = 0 ; i < m->out_iov_cnt ; i++ )
+    {
+        ecu_pool_put(&ctx->pool, m->out_blk[i]);
     }
-    return -1;
+    m->out_iov_cnt = 0;
+    m->out_pending = 0;
+
+    return result;
 }
 
 
 /*******************************************************************************
  **
- ** Function        ecu_merger_save_msg_reorder_buffer
+ ** Function        ecu_merger_uring_write
  **
- ** Description     save a block to reorder buffer
+ ** Description     write blocks in output stage with io_uring.
+ **                 previous flush is completed first, so one flush is
+ **                 in flight while merger collects next one
  **
- ** Parameters      block pointer
+ ** Parameters      ctx : context
  **
- ** Returns         0 is success
- **                 -1 is error
+ ** Returns         none
  **
  *******************************************************************************/
-static int ecu_merger_save_msg_reorder_buffer(struct ecu_enc_msg *enc_msg)
+static void ecu_merger_uring_write(struct ecu_ctx *ctx)
 {
+    struct ecu_merger *m = &ctx->merger;
+    struct ecu_block *blk;
     unsigned int i;
 
-    for (i=0;i<ECU_MERGER_MAX_QUEUE_NUM;i++)
+    ecu_merger_uring_wait(ctx, 0);
+
+    for( i = 0 ; i < m->out_iov_cnt ; i++ )
     {
-        if(ECU_MERGER_REODER_Q[i].in_use == 0)
+        blk = m->out_blk[i];
+        /* output stage can be longer than submission queue */
+        while( (m->result == 0) &&
+               ecu_uring_prep(&m->out_ring, 1, ctx->out_fd, blk->p_data,
+                              blk->data_len, m->out_offset, blk) )
         {
-            ECU_MERGER_REODER_Q[i].in_use = 1;
-            ECU_MERGER_REODER_Q[i].data_len = enc_msg->data_len;
-            ECU_MERGER_REODER_Q[i].seq_num = enc_msg->seq_num;
-            ECU_MERGER_REODER_Q[i].p_enc_data = malloc(ECU_MERGER_REODER_Q[i].data_len);
-            memcpy(ECU_MERGER_REODER_Q[i].p_enc_data, enc_msg->p_enc_data, ECU_MERGER_REODER_Q[i].data_len);
-            free(enc_msg->p_enc_data);
-            return 0;
+            ecu_merger_uring_wait(ctx, ECU_URING_DEPTH / 2);
         }
+        if( m->result )
+        {
+            /* after write error, the rest of stream is dropped */
+            ecu_pool_put(&ctx->pool, blk);
+            continue;
+        }
+        m->out_offset += blk->data_len;
     }
-    if (i == ECU_MERGER_MAX_QUEUE_NUM)
+    ecu_uring_submit(&m->out_ring, 0);
+
+    m->out_iov_cnt = 0;
+    m->out_pending = 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_uring_wait
+ **
+ ** Description     wait for io_uring writes and put written blocks
+ **                 back to pool. at the end, output offset is moved
+ **                 after written data as writev() does
+ **
+ ** Parameters      ctx : context
+ **                 left : number of writes allowed to stay in flight
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_merger_uring_wait(struct ecu_ctx *ctx, unsigned int left)
+{
+    struct ecu_merger *m = &ctx->merger;
+    struct ecu_block *blk;
+    void *user;
+    int res;
+
+    if( m->out_uring == 0 )
     {
-        /* reorder buffer overflowed */
-        printf("reorder buffer overflowed!!\n");
-        exit(1);
-        return -1;
+        return;
+    }
+
+    while( m->out_ring.inflight > left )
+    {
+        if( ecu_uring_submit(&m->out_ring, 1) )
+        {
+            /* writes in flight are lost, context is not used again */
+            m->result = -1;
+            m->out_ring.inflight = 0;
+            break;
+        }
+        while( ecu_uring_reap(&m->out_ring, &user, &res) )
+        {
+            blk = user;
+            /* regular file is written short only when disk is full */
+            if( (res < 0) || ((unsigned int)res != blk->data_len) )
+            {
+                fprintf(stderr, "write error %d\n", (res < 0) ? -res : ENOSPC);
+                m->result = -1;
+            }
+            ecu_pool_put(&ctx->pool, blk);
+        }
+    }
+
+    if( left == 0 )
+    {
+        lseek(ctx->out_fd, m->out_offset, SEEK_SET);
     }
-    return 0;
 }
@@ -2,18 +2,81 @@
 #ifndef ECU_MERGER_H
 #define ECU_MERGER_H
 
+#include <pthread.h>
+#include <sys/uio.h>
 
-#define ECU_MERGER_MAX_QUEUE_NUM 1000
+#include "ecu_uring.h"
 
-struct ecu_merger_msg
+
+/* Reorder buffer size, power of 2.
+ * block of seq number n is saved in slot (n % ECU_MERGER_MAX_QUEUE_NUM)
+ */
+#define ECU_MERGER_MAX_QUEUE_NUM 1024
+
+/* Default output flush size (byte) */
+#define ECU_MERGER_FLUSH_SIZE (1024*1024)
+
+/* Maximum blocks in one writev(), IOV_MAX of Linux */
+#define ECU_MERGER_MAX_IOV 1024
+
+struct ecu_ctx;
+struct ecu_block;
+
+/* merger of a context */
+struct ecu_merger
 {
-    unsigned int seq_num;
-    unsigned char *p_enc_data;
-    unsigned int data_len;
-    unsigned char in_use;
+    pthread_t tid;
+    int result;                     /* -1 if output failed */
+    unsigned long long seq_out;     /* expected sequence number */
+
+    /* reorder queue to print out block as sequence number order */
+    struct ecu_block *reorder_q[ECU_MERGER_MAX_QUEUE_NUM];
+
+    /* output stage, in-order blocks waiting for writev() to output fd */
+    struct iovec out_iov[ECU_MERGER_MAX_IOV];
+    struct ecu_block *out_blk[ECU_MERGER_MAX_IOV];
+    unsigned int out_iov_cnt;       /* number of blocks in output stage */
+    unsigned int out_pending;       /* bytes in output stage */
+    int out_fd;                     /* output fd of blocks in output stage */
+    unsigned int out_file;          /* file of out_fd in batch */
+
+    /* io_uring output. blocks of one flush are written at their offsets
+     * of output file while merger collects next flush
+     */
+    struct ecu_uring out_ring;
+    int out_uring;                  /* 0 is writev() output */
+    unsigned long long out_offset;  /* output offset of next block */
 };
 
-int ecu_merger_t_start();
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_t_start
+ **
+ ** Description     create merger thread
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 the others are errors
+ **
+ *******************************************************************************/
+int ecu_merger_t_start(struct ecu_ctx *ctx);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_merger_t_join
+ **
+ ** Description     wait for merger thread to write out whole stream.
+ **                 end of stream markers merger did not take are dropped
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         0 is success
+ **                 -1 if output failed
+ **
+ *******************************************************************************/
+int ecu_merger_t_join(struct ecu_ctx *ctx);
 
 
 #endif
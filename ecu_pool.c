@@ -0,0 +1,165 @@
+/*****************************************************************************
+**
+**  Name:           ecu_pool.c
+**
+**  Description:    fixed size block pool.
+**                  every block is allocated at startup and handed
+**                  from distributor to encryptor to merger by pointer,
+**                  so no heap allocation happens while streaming.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ecu_pool.h"
+
+/* end of stream marker */
+struct ecu_block ECU_BLOCK_EOS;
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_init
+ **
+ ** Description     allocate every block of pool
+ **
+ ** Parameters      pool : block pool
+ **                 block_num : number of blocks
+ **                 block_size : data size of one block
+ **                 wait_mode : ECU_WAIT_xxx when pool is empty
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_pool_init(struct ecu_pool *pool, unsigned int block_num,
+                  unsigned int block_size, unsigned int wait_mode)
+{
+    unsigned int i;
+    unsigned int rb_size;
+    size_t stride;
+
+    /* free ring buffer must hold every block */
+    rb_size = 2;
+    while( rb_size < block_num )
+    {
+        rb_size <<= 1;
+    }
+    if( ecu_ring_init(&pool->free_rb, rb_size, wait_mode) )
+    {
+        return -1;
+    }
+
+    /* each block starts at cache line boundary */
+    stride = ((size_t)block_size + ECU_RING_CACHE_LINE - 1) & ~((size_t)ECU_RING_CACHE_LINE - 1);
+
+    pool->blocks = malloc(sizeof(struct ecu_block) * block_num);
+    pool->arena = aligned_alloc(ECU_RING_CACHE_LINE, stride * block_num);
+    if( (pool->blocks == NULL) || (pool->arena == NULL) )
+    {
+        fprintf(stderr, "block pool alloc error! %u x %u\n", block_num, block_size);
+        free(pool->blocks);
+        free(pool->arena);
+        ecu_ring_destroy(&pool->free_rb);
+        return -1;
+    }
+
+    for( i = 0 ; i < block_num ; i++ )
+    {
+        pool->blocks[i].seq_num = 0;
+        pool->blocks[i].data_len = 0;
+        pool->blocks[i].p_data = pool->arena + stride * i;
+        ecu_ring_push(&pool->free_rb, &pool->blocks[i]);
+    }
+    pool->arena_size = stride * block_num;
+    pool->block_num = block_num;
+    pool->block_size = block_size;
+
+#ifdef DEBUG
+    printf("block pool %u x %u\n", block_num, block_size);
+#endif
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_destroy
+ **
+ ** Description     release every block of pool
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_pool_destroy(struct ecu_pool *pool)
+{
+    ecu_ring_destroy(&pool->free_rb);
+    free(pool->blocks);
+    free(pool->arena);
+    pool->blocks = NULL;
+    pool->arena = NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_get
+ **
+ ** Description     get a free block. wait until a block is put back
+ **                 if pool is empty
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         free block
+ **
+ *******************************************************************************/
+struct ecu_block *ecu_pool_get(struct ecu_pool *pool)
+{
+    struct ecu_block *blk;
+
+    do
+    {
+        blk = ecu_ring_pop_wait(&pool->free_rb);
+    } while( blk == NULL );
+
+    return blk;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_try_get
+ **
+ ** Description     get a free block without waiting
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         free block
+ **                 NULL if pool is empty
+ **
+ *******************************************************************************/
+struct ecu_block *ecu_pool_try_get(struct ecu_pool *pool)
+{
+    return ecu_ring_pop(&pool->free_rb);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_put
+ **
+ ** Description     put a block back to pool
+ **
+ ** Parameters      pool : block pool
+ **                 blk : block from ecu_pool_get
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_pool_put(struct ecu_pool *pool, struct ecu_block *blk)
+{
+    /* free ring buffer can hold every block, never full */
+    ecu_ring_push(&pool->free_rb, blk);
+}
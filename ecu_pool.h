@@ -0,0 +1,117 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_POOL_H
+#define ECU_POOL_H
+
+#include <stddef.h>
+
+#include "ecu_ring.h"
+
+/* Maximum memory of block pool (byte) */
+#define ECU_POOL_MAX_SIZE (256*1024*1024)
+
+/* one data block handed from stage to stage by pointer.
+ * owner of the pointer is the only one touching the block
+ */
+struct ecu_block
+{
+    unsigned long long seq_num; /* sequence number of block */
+    unsigned long long offset;  /* offset of block in its file, picks keystream */
+    unsigned int file_id;   /* file of block in batch, 0 otherwise */
+    unsigned int data_len;  /* length of valid data */
+    unsigned char *p_data;  /* block_size bytes in pool arena */
+};
+
+/* end of stream marker. sent after last block through every ring
+ * and queue in place of a block, never belongs to pool
+ */
+extern struct ecu_block ECU_BLOCK_EOS;
+
+/* fixed size block pool, every block is allocated at init */
+struct ecu_pool
+{
+    struct ecu_ring free_rb;    /* free blocks */
+    struct ecu_block *blocks;   /* block descriptors */
+    unsigned char *arena;       /* data of every block */
+    size_t arena_size;
+    unsigned int block_num;
+    unsigned int block_size;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_init
+ **
+ ** Description     allocate every block of pool
+ **
+ ** Parameters      pool : block pool
+ **                 block_num : number of blocks
+ **                 block_size : data size of one block
+ **                 wait_mode : ECU_WAIT_xxx when pool is empty
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_pool_init(struct ecu_pool *pool, unsigned int block_num,
+                  unsigned int block_size, unsigned int wait_mode);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_destroy
+ **
+ ** Description     release every block of pool
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_pool_destroy(struct ecu_pool *pool);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_get
+ **
+ ** Description     get a free block. wait until a block is put back
+ **                 if pool is empty
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         free block
+ **
+ *******************************************************************************/
+struct ecu_block *ecu_pool_get(struct ecu_pool *pool);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_try_get
+ **
+ ** Description     get a free block without waiting
+ **
+ ** Parameters      pool : block pool
+ **
+ ** Returns         free block
+ **                 NULL if pool is empty
+ **
+ *******************************************************************************/
+struct ecu_block *ecu_pool_try_get(struct ecu_pool *pool);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_pool_put
+ **
+ ** Description     put a block back to pool
+ **
+ ** Parameters      pool : block pool
+ **                 blk : block from ecu_pool_get
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_pool_put(struct ecu_pool *pool, struct ecu_block *blk);
+
+#endif
@@ -0,0 +1,554 @@
+/*****************************************************************************
+**
+**  Name:           ecu_ring.c
+**
+**  Description:    bounded lock-free MPMC ring buffer.
+**                  each slot has sequence number so that producers and
+**                  consumers only contend on their own counter.
+**                  and bounded SPSC ring buffer for one producer
+**                  and one consumer.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ecu_ring.h"
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_init
+ **
+ ** Description     init ring buffer
+ **
+ ** Parameters      ring : ring buffer
+ **                 size : number of slots, must be power of 2
+ **                 wait_mode : ECU_WAIT_xxx for push/pop wait
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_ring_init(struct ecu_ring *ring, unsigned int size, unsigned int wait_mode)
+{
+    unsigned int i;
+
+    if( (size < 2) || (size & (size - 1)) )
+    {
+        fprintf(stderr, "ring size should be power of 2 : %u\n", size);
+        return -1;
+    }
+
+    ring->slots = aligned_alloc(ECU_RING_CACHE_LINE,
+                    ((sizeof(struct ecu_ring_slot) * size + ECU_RING_CACHE_LINE - 1)
+                     / ECU_RING_CACHE_LINE) * ECU_RING_CACHE_LINE);
+    if( ring->slots == NULL )
+    {
+        return -1;
+    }
+
+    /* slot i is ready for i-th push */
+    for( i = 0 ; i < size ; i++ )
+    {
+        atomic_init(&ring->slots[i].seq, i);
+        ring->slots[i].data = NULL;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->wptr, 0);
+    atomic_init(&ring->rptr, 0);
+    ecu_wait_init(&ring->not_empty, wait_mode);
+    ecu_wait_init(&ring->not_full, wait_mode);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_destroy
+ **
+ ** Description     release slots of ring buffer
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_destroy(struct ecu_ring *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_push
+ **
+ ** Description     push one pointer to ring buffer.
+ **                 safe for multi producers
+ **
+ ** Parameters      ring : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is ring buffer full
+ **
+ *******************************************************************************/
+int ecu_ring_push(struct ecu_ring *ring, void *data)
+{
+    struct ecu_ring_slot *slot;
+    unsigned long pos, seq;
+    long diff;
+
+    pos = atomic_load_explicit(&ring->wptr, memory_order_relaxed);
+    while(1)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        diff = (long)seq - (long)pos;
+        if( diff == 0 )
+        {
+            /* slot is free, claim it */
+            if( atomic_compare_exchange_weak_explicit(&ring->wptr, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed) )
+            {
+                break;
+            }
+        }
+        else if( diff < 0 )
+        {
+            /* slot still holds data of previous lap, ring is full */
+            return -1;
+        }
+        else
+        {
+            /* other producer took this slot */
+            pos = atomic_load_explicit(&ring->wptr, memory_order_relaxed);
+        }
+    }
+
+    slot->data = data;
+    /* publish to consumer */
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    ecu_wait_signal(&ring->not_empty);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_pop
+ **
+ ** Description     pop one pointer from ring buffer.
+ **                 safe for multi consumers
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if ring buffer is empty
+ **
+ *******************************************************************************/
+void *ecu_ring_pop(struct ecu_ring *ring)
+{
+    struct ecu_ring_slot *slot;
+    unsigned long pos, seq;
+    long diff;
+    void *data;
+
+    pos = atomic_load_explicit(&ring->rptr, memory_order_relaxed);
+    while(1)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        diff = (long)seq - (long)(pos + 1);
+        if( diff == 0 )
+        {
+            /* slot has data, claim it */
+            if( atomic_compare_exchange_weak_explicit(&ring->rptr, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed) )
+            {
+                break;
+            }
+        }
+        else if( diff < 0 )
+        {
+            /* no data was published to this slot, ring is empty */
+            return NULL;
+        }
+        else
+        {
+            /* other consumer took this slot */
+            pos = atomic_load_explicit(&ring->rptr, memory_order_relaxed);
+        }
+    }
+
+    data = slot->data;
+    /* give slot back to producer of next lap */
+    atomic_store_explicit(&slot->seq, pos + ring->mask + 1, memory_order_release);
+    ecu_wait_signal(&ring->not_full);
+
+    return data;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_push_wait
+ **
+ ** Description     push one pointer to ring buffer.
+ **                 wait until ring buffer has room
+ **
+ ** Parameters      ring : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_push_wait(struct ecu_ring *ring, void *data)
+{
+    unsigned int spin = 0;
+    unsigned int key;
+
+    while( ecu_ring_push(ring, data) < 0 )
+    {
+        if( !ecu_wait_spin(&ring->not_full, &spin) )
+        {
+            continue;
+        }
+
+        /* consumer may pop between first try and prepare, try again */
+        key = ecu_wait_prepare(&ring->not_full);
+        if( ecu_ring_push(ring, data) == 0 )
+        {
+            ecu_wait_cancel(&ring->not_full);
+            break;
+        }
+        ecu_wait_commit(&ring->not_full, key);
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_pop_wait
+ **
+ ** Description     pop one pointer from ring buffer.
+ **                 wait until ring buffer has data or ecu_ring_notify
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if woken up without data
+ **
+ *******************************************************************************/
+void *ecu_ring_pop_wait(struct ecu_ring *ring)
+{
+    unsigned int spin = 0;
+    unsigned int key;
+    void *data;
+
+    while(1)
+    {
+        data = ecu_ring_pop(ring);
+        if( data )
+        {
+            return data;
+        }
+        if( ecu_wait_spin(&ring->not_empty, &spin) )
+        {
+            break;
+        }
+    }
+
+    /* producer may push between last try and prepare, try again */
+    key = ecu_wait_prepare(&ring->not_empty);
+    data = ecu_ring_pop(ring);
+    if( data )
+    {
+        ecu_wait_cancel(&ring->not_empty);
+        return data;
+    }
+    ecu_wait_commit(&ring->not_empty, key);
+
+    return ecu_ring_pop(ring);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_notify
+ **
+ ** Description     wake up consumers waiting in ecu_ring_pop_wait
+ **                 without pushing data
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_notify(struct ecu_ring *ring)
+{
+    ecu_wait_signal(&ring->not_empty);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_count
+ **
+ ** Description     get number of pointers in ring buffer.
+ **                 value can be stale when other threads push or pop
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         number of pointers
+ **
+ *******************************************************************************/
+unsigned int ecu_ring_count(struct ecu_ring *ring)
+{
+    unsigned long wptr, rptr;
+
+    rptr = atomic_load_explicit(&ring->rptr, memory_order_relaxed);
+    wptr = atomic_load_explicit(&ring->wptr, memory_order_relaxed);
+
+    if( wptr <= rptr )
+    {
+        return 0;
+    }
+    return (unsigned int)(wptr - rptr);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_init
+ **
+ ** Description     init single producer single consumer ring buffer
+ **
+ ** Parameters      q : ring buffer
+ **                 size : number of slots, must be power of 2
+ **                 wait_mode : ECU_WAIT_xxx for push/pop wait
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_spsc_init(struct ecu_spsc *q, unsigned int size, unsigned int wait_mode)
+{
+    if( (size < 2) || (size & (size - 1)) )
+    {
+        fprintf(stderr, "ring size should be power of 2 : %u\n", size);
+        return -1;
+    }
+
+    q->slots = calloc(size, sizeof(void *));
+    if( q->slots == NULL )
+    {
+        return -1;
+    }
+
+    q->mask = size - 1;
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    q->head_cache = 0;
+    q->tail_cache = 0;
+    ecu_wait_init(&q->not_empty, wait_mode);
+    ecu_wait_init(&q->not_full, wait_mode);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_destroy
+ **
+ ** Description     release slots of ring buffer
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_destroy(struct ecu_spsc *q)
+{
+    free(q->slots);
+    q->slots = NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_push
+ **
+ ** Description     push one pointer. only one thread may push
+ **
+ ** Parameters      q : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is ring buffer full
+ **
+ *******************************************************************************/
+int ecu_spsc_push(struct ecu_spsc *q, void *data)
+{
+    unsigned long tail;
+
+    tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if( tail - q->head_cache > q->mask )
+    {
+        /* looks full, see how far consumer is */
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if( tail - q->head_cache > q->mask )
+        {
+            return -1;
+        }
+    }
+
+    q->slots[tail & q->mask] = data;
+    /* publish to consumer */
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    ecu_wait_signal(&q->not_empty);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_pop
+ **
+ ** Description     pop one pointer. only one thread may pop
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if ring buffer is empty
+ **
+ *******************************************************************************/
+void *ecu_spsc_pop(struct ecu_spsc *q)
+{
+    unsigned long head;
+    void *data;
+
+    head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if( head == q->tail_cache )
+    {
+        /* looks empty, see how far producer is */
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if( head == q->tail_cache )
+        {
+            return NULL;
+        }
+    }
+
+    data = q->slots[head & q->mask];
+    /* give slot back to producer */
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    ecu_wait_signal(&q->not_full);
+
+    return data;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_push_wait
+ **
+ ** Description     push one pointer. wait until ring buffer has room
+ **
+ ** Parameters      q : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_push_wait(struct ecu_spsc *q, void *data)
+{
+    unsigned int spin = 0;
+    unsigned int key;
+
+    while( ecu_spsc_push(q, data) < 0 )
+    {
+        if( !ecu_wait_spin(&q->not_full, &spin) )
+        {
+            continue;
+        }
+
+        /* consumer may pop between first try and prepare, try again */
+        key = ecu_wait_prepare(&q->not_full);
+        if( ecu_spsc_push(q, data) == 0 )
+        {
+            ecu_wait_cancel(&q->not_full);
+            break;
+        }
+        ecu_wait_commit(&q->not_full, key);
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_pop_wait
+ **
+ ** Description     pop one pointer.
+ **                 wait until ring buffer has data or ecu_spsc_notify
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if woken up without data
+ **
+ *******************************************************************************/
+void *ecu_spsc_pop_wait(struct ecu_spsc *q)
+{
+    unsigned int spin = 0;
+    unsigned int key;
+    void *data;
+
+    while(1)
+    {
+        data = ecu_spsc_pop(q);
+        if( data )
+        {
+            return data;
+        }
+        if( ecu_wait_spin(&q->not_empty, &spin) )
+        {
+            break;
+        }
+    }
+
+    /* producer may push between last try and prepare, try again */
+    key = ecu_wait_prepare(&q->not_empty);
+    data = ecu_spsc_pop(q);
+    if( data )
+    {
+        ecu_wait_cancel(&q->not_empty);
+        return data;
+    }
+    ecu_wait_commit(&q->not_empty, key);
+
+    return ecu_spsc_pop(q);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_notify
+ **
+ ** Description     wake up consumer waiting in ecu_spsc_pop_wait
+ **                 without pushing data
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_notify(struct ecu_spsc *q)
+{
+    ecu_wait_signal(&q->not_empty);
+}
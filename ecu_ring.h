@@ -0,0 +1,281 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_RING_H
+#define ECU_RING_H
+
+#include <stdatomic.h>
+
+#include "ecu_wait.h"
+
+/* cache line size, keeps producer and consumer counters apart */
+#define ECU_RING_CACHE_LINE 64
+
+/* one slot of ring buffer.
+ * seq tells whether the slot is ready for producer or consumer
+ */
+struct ecu_ring_slot
+{
+    atomic_ulong seq;
+    void *data;
+};
+
+/* bounded lock-free MPMC ring buffer of pointers */
+struct ecu_ring
+{
+    _Alignas(ECU_RING_CACHE_LINE) atomic_ulong wptr;  /* next slot to push */
+    _Alignas(ECU_RING_CACHE_LINE) atomic_ulong rptr;  /* next slot to pop */
+    _Alignas(ECU_RING_CACHE_LINE) unsigned long mask;
+    struct ecu_ring_slot *slots;
+    _Alignas(ECU_RING_CACHE_LINE) struct ecu_wait not_empty; /* consumers wait */
+    _Alignas(ECU_RING_CACHE_LINE) struct ecu_wait not_full;  /* producers wait */
+};
+
+/* bounded single producer single consumer ring buffer of pointers.
+ * each side keeps a cached copy of the other side's counter
+ * and reads the shared one only when the cache says full or empty
+ */
+struct ecu_spsc
+{
+    _Alignas(ECU_RING_CACHE_LINE) atomic_ulong tail;  /* producer, next slot to push */
+    unsigned long head_cache;                         /* producer's copy of head */
+    _Alignas(ECU_RING_CACHE_LINE) atomic_ulong head;  /* consumer, next slot to pop */
+    unsigned long tail_cache;                         /* consumer's copy of tail */
+    _Alignas(ECU_RING_CACHE_LINE) unsigned long mask;
+    void **slots;
+    _Alignas(ECU_RING_CACHE_LINE) struct ecu_wait not_empty; /* consumer waits */
+    _Alignas(ECU_RING_CACHE_LINE) struct ecu_wait not_full;  /* producer waits */
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_init
+ **
+ ** Description     init ring buffer
+ **
+ ** Parameters      ring : ring buffer
+ **                 size : number of slots, must be power of 2
+ **                 wait_mode : ECU_WAIT_xxx for push/pop wait
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_ring_init(struct ecu_ring *ring, unsigned int size, unsigned int wait_mode);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_destroy
+ **
+ ** Description     release slots of ring buffer
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_destroy(struct ecu_ring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_push
+ **
+ ** Description     push one pointer to ring buffer.
+ **                 safe for multi producers
+ **
+ ** Parameters      ring : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is ring buffer full
+ **
+ *******************************************************************************/
+int ecu_ring_push(struct ecu_ring *ring, void *data);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_pop
+ **
+ ** Description     pop one pointer from ring buffer.
+ **                 safe for multi consumers
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if ring buffer is empty
+ **
+ *******************************************************************************/
+void *ecu_ring_pop(struct ecu_ring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_push_wait
+ **
+ ** Description     push one pointer to ring buffer.
+ **                 wait until ring buffer has room
+ **
+ ** Parameters      ring : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_push_wait(struct ecu_ring *ring, void *data);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_pop_wait
+ **
+ ** Description     pop one pointer from ring buffer.
+ **                 wait until ring buffer has data or ecu_ring_notify
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if woken up without data
+ **
+ *******************************************************************************/
+void *ecu_ring_pop_wait(struct ecu_ring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_notify
+ **
+ ** Description     wake up consumers waiting in ecu_ring_pop_wait
+ **                 without pushing data
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_ring_notify(struct ecu_ring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_ring_count
+ **
+ ** Description     get number of pointers in ring buffer.
+ **                 value can be stale when other threads push or pop
+ **
+ ** Parameters      ring : ring buffer
+ **
+ ** Returns         number of pointers
+ **
+ *******************************************************************************/
+unsigned int ecu_ring_count(struct ecu_ring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_init
+ **
+ ** Description     init single producer single consumer ring buffer
+ **
+ ** Parameters      q : ring buffer
+ **                 size : number of slots, must be power of 2
+ **                 wait_mode : ECU_WAIT_xxx for push/pop wait
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_spsc_init(struct ecu_spsc *q, unsigned int size, unsigned int wait_mode);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_destroy
+ **
+ ** Description     release slots of ring buffer
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_destroy(struct ecu_spsc *q);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_push
+ **
+ ** Description     push one pointer. only one thread may push
+ **
+ ** Parameters      q : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         0 is success
+ **                 -1 is ring buffer full
+ **
+ *******************************************************************************/
+int ecu_spsc_push(struct ecu_spsc *q, void *data);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_pop
+ **
+ ** Description     pop one pointer. only one thread may pop
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if ring buffer is empty
+ **
+ *******************************************************************************/
+void *ecu_spsc_pop(struct ecu_spsc *q);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_push_wait
+ **
+ ** Description     push one pointer. wait until ring buffer has room
+ **
+ ** Parameters      q : ring buffer
+ **                 data : pointer to push
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_push_wait(struct ecu_spsc *q, void *data);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_pop_wait
+ **
+ ** Description     pop one pointer.
+ **                 wait until ring buffer has data or ecu_spsc_notify
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         popped pointer
+ **                 NULL if woken up without data
+ **
+ *******************************************************************************/
+void *ecu_spsc_pop_wait(struct ecu_spsc *q);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_spsc_notify
+ **
+ ** Description     wake up consumer waiting in ecu_spsc_pop_wait
+ **                 without pushing data
+ **
+ ** Parameters      q : ring buffer
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_spsc_notify(struct ecu_spsc *q);
+
+#endif
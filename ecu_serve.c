@@ -0,0 +1,557 @@
+/*****************************************************************************
+**
+**  Name:           ecu_serve.c
+**
+**  Description:    encryptUtil daemon on a Unix socket.
+**                  every client stream runs in its own thread with a
+**                  context of its key. contexts of finished streams are
+**                  cached with their pipeline threads parked, so a
+**                  stream of a known key skips keystream build, block
+**                  allocation and thread creation.
+**                  contexts, running and idle, share one budget:
+**                  - encryptor threads of all contexts fit the CPUs,
+**                    at least one context is allowed
+**                  - block pools of all contexts fit
+**                    ECU_SERVE_POOL_BUDGET
+**                  idle contexts are destroyed, oldest first, to make
+**                  room. when every context is running, a new stream
+**                  waits for one of them to finish, so streams beyond
+**                  the budget take turns on the same encryptors instead
+**                  of oversubscribing the CPUs.
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "ecu_serve.h"
+#include "ecu_client.h"
+#include "ecu_ctx.h"
+#include "ecu_io.h"
+#include "ecu_cpu.h"
+
+
+/* idle context kept for next stream of same key */
+struct ecu_serve_idle
+{
+    struct ecu_ctx *ctx;
+    unsigned char *key;
+    size_t key_size;
+};
+
+
+/* static function definitions */
+static int ecu_serve_listen(const char *path);
+static void ecu_serve_signal(int sig);
+static void *ecu_serve_thread(void *ptr);
+static struct ecu_ctx *ecu_serve_get_ctx(const unsigned char *key, size_t key_size);
+static void ecu_serve_put_ctx(struct ecu_ctx *ctx, unsigned char *key, size_t key_size);
+static void ecu_serve_drop_ctx(struct ecu_ctx *ctx);
+static int ecu_serve_reply(int fd, uint32_t status);
+
+
+/* configuration of every context */
+static struct ecu_config ecu_serve_cfg;
+
+/* idle contexts, oldest first */
+static struct ecu_serve_idle ecu_serve_idle_list[ECU_SERVE_MAX_IDLE];
+static unsigned int ecu_serve_idle_cnt = 0;
+
+/* streams running now */
+static unsigned int ecu_serve_stream_cnt = 0;
+static pthread_mutex_t ecu_serve_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ecu_serve_done = PTHREAD_COND_INITIALIZER;
+
+/* budget of contexts, running and idle */
+static unsigned int ecu_serve_ctx_max = 1;     /* by encryptor threads */
+static unsigned int ecu_serve_ctx_cnt = 0;
+static size_t ecu_serve_pool_used = 0;          /* block pools (byte) */
+static pthread_cond_t ecu_serve_free = PTHREAD_COND_INITIALIZER;
+
+/* set by SIGINT or SIGTERM */
+static volatile sig_atomic_t ecu_serve_stop = 0;
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve
+ **
+ ** Description     run daemon on a Unix socket until SIGINT or SIGTERM.
+ **                 each stream gets a context of its key, idle contexts
+ **                 with keystream, block pool, rings and parked threads
+ **                 are kept for next streams of the same key.
+ **                 contexts share budget of encryptor threads and pools
+ **
+ ** Parameters      path : Unix socket
+ **                 cfg : configuration of every context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_serve(const char *path, const struct ecu_config *cfg)
+{
+    struct sigaction sa;
+    struct pollfd pfd;
+    pthread_attr_t attr;
+    pthread_t tid;
+    sigset_t mask, old_mask;
+    unsigned int i, cpu_cnt, enc_num;
+    int lfd, fd;
+
+    ecu_serve_cfg = *cfg;
+    ecu_serve_cfg.keep_threads = 1;
+
+    /* encryptors of all contexts fit the CPUs, 0 threads is as
+     * ecu_create takes it, number of CPUs less distributor and merger
+     */
+    cpu_cnt = ecu_cpu_count();
+    enc_num = cfg->num_of_enc_thread;
+    if( enc_num == 0 )
+    {
+        enc_num = (cpu_cnt > 2) ? cpu_cnt - 2 : 1;
+    }
+    ecu_serve_ctx_max = cpu_cnt / enc_num;
+    if( ecu_serve_ctx_max == 0 )
+    {
+        ecu_serve_ctx_max = 1;
+    }
+#ifdef DEBUG
+    printf("contexts up to %u\n", ecu_serve_ctx_max);
+#endif
+
+    /* client gone is a write error of its stream, not end of daemon */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* only accept loop takes SIGINT and SIGTERM, stream threads
+     * inherit blocked mask
+     */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = ecu_serve_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    lfd = ecu_serve_listen(path);
+    if( lfd < 0 )
+    {
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        return -1;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+#ifdef DEBUG
+    printf("serving %s\n", path);
+#endif
+    pfd.fd = lfd;
+    pfd.events = POLLIN;
+    while( ecu_serve_stop == 0 )
+    {
+        /* signals are taken only while waiting here */
+        if( ppoll(&pfd, 1, NULL, &old_mask) < 0 )
+        {
+            continue;
+        }
+
+        fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if( fd < 0 )
+        {
+            continue;
+        }
+
+        /* refused before a thread is spent on it */
+        pthread_mutex_lock(&ecu_serve_lock);
+        if( ecu_serve_stream_cnt >= ECU_SERVE_MAX_STREAM )
+        {
+            pthread_mutex_unlock(&ecu_serve_lock);
+            ecu_serve_reply(fd, ECU_SERVE_BUSY);
+            close(fd);
+            continue;
+        }
+        ecu_serve_stream_cnt++;
+        pthread_mutex_unlock(&ecu_serve_lock);
+
+        if( pthread_create(&tid, &attr, ecu_serve_thread, (void *)(intptr_t)fd) )
+        {
+            fprintf(stderr, "cannot create stream thread\n");
+            close(fd);
+            pthread_mutex_lock(&ecu_serve_lock);
+            ecu_serve_stream_cnt--;
+            pthread_mutex_unlock(&ecu_serve_lock);
+        }
+    }
+
+    /* no new stream, running ones finish */
+    close(lfd);
+    unlink(path);
+    pthread_attr_destroy(&attr);
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    while( ecu_serve_stream_cnt > 0 )
+    {
+        pthread_cond_wait(&ecu_serve_done, &ecu_serve_lock);
+    }
+    for( i = 0 ; i < ecu_serve_idle_cnt ; i++ )
+    {
+        ecu_destroy(ecu_serve_idle_list[i].ctx);
+        free(ecu_serve_idle_list[i].key);
+    }
+    ecu_serve_idle_cnt = 0;
+    ecu_serve_ctx_cnt = 0;
+    ecu_serve_pool_used = 0;
+    pthread_mutex_unlock(&ecu_serve_lock);
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_listen
+ **
+ ** Description     listen on Unix socket.
+ **                 socket file left by a dead daemon is removed,
+ **                 socket of a running daemon is not
+ **
+ ** Parameters      path : Unix socket
+ **
+ ** Returns         listening socket
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_serve_listen(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if( strlen(path) >= sizeof(addr.sun_path) )
+    {
+        fprintf(stderr, "socket path too long %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if( fd < 0 )
+    {
+        fprintf(stderr, "socket error %d\n", errno);
+        return -1;
+    }
+
+    if( (stat(path, &st) == 0) && S_ISSOCK(st.st_mode) )
+    {
+        if( connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 )
+        {
+            fprintf(stderr, "daemon is running on %s\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if( bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(fd, SOMAXCONN) )
+    {
+        fprintf(stderr, "cannot listen on %s, error %d\n", path, errno);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_signal
+ **
+ ** Description     stop accepting streams
+ **
+ ** Parameters      sig : signal
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_serve_signal(int sig)
+{
+    (void)sig;
+    ecu_serve_stop = 1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_thread
+ **
+ ** Description     serve one client stream.
+ **                 header and key are read, then stream runs from socket
+ **                 back into the same socket until client closes its
+ **                 sending side
+ **
+ ** Parameters      ptr : socket of client
+ **
+ ** Returns         NULL
+ **
+ *******************************************************************************/
+static void *ecu_serve_thread(void *ptr)
+{
+    struct ecu_serve_hdr hdr;
+    struct ecu_ctx *ctx = NULL;
+    unsigned char *key = NULL;
+    int fd = (int)(intptr_t)ptr;
+    int result;
+
+    if( (ecu_io_read(fd, (unsigned char *)&hdr, sizeof(hdr)) != sizeof(hdr)) ||
+        (hdr.magic != ECU_SERVE_MAGIC) ||
+        (hdr.key_size == 0) || (hdr.key_size > ECU_KEY_MAX) )
+    {
+        ecu_serve_reply(fd, ECU_SERVE_ERROR);
+        goto done;
+    }
+
+    key = malloc(hdr.key_size);
+    if( (key == NULL) ||
+        (ecu_io_read(fd, key, hdr.key_size) != (int)hdr.key_size) )
+    {
+        ecu_serve_reply(fd, ECU_SERVE_ERROR);
+        goto done;
+    }
+
+    ctx = ecu_serve_get_ctx(key, hdr.key_size);
+    if( ctx == NULL )
+    {
+        ecu_serve_reply(fd, ECU_SERVE_ERROR);
+        goto done;
+    }
+    if( ecu_serve_reply(fd, ECU_SERVE_OK) )
+    {
+        ecu_serve_put_ctx(ctx, key, hdr.key_size);
+        key = NULL;
+        goto done;
+    }
+
+    result = ecu_process_fd(ctx, fd, fd, 0);
+
+    /* client sees end of output before context is put back */
+    close(fd);
+    fd = -1;
+    if( result == 0 )
+    {
+        ecu_serve_put_ctx(ctx, key, hdr.key_size);
+        key = NULL;
+    }
+    else
+    {
+        ecu_serve_drop_ctx(ctx);
+    }
+
+done:
+    if( fd >= 0 )
+    {
+        close(fd);
+    }
+    free(key);
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    ecu_serve_stream_cnt--;
+    pthread_cond_signal(&ecu_serve_done);
+    pthread_mutex_unlock(&ecu_serve_lock);
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_get_ctx
+ **
+ ** Description     take idle context of key, newest first,
+ **                 or create a new one within budget. idle contexts of
+ **                 other keys are destroyed, oldest first, to make room.
+ **                 waits for a running context to finish when budget
+ **                 is taken by running ones
+ **
+ ** Parameters      key : key data
+ **                 key_size : size of key
+ **
+ ** Returns         context
+ **                 NULL is error
+ **
+ *******************************************************************************/
+static struct ecu_ctx *ecu_serve_get_ctx(const unsigned char *key, size_t key_size)
+{
+    struct ecu_serve_idle *idle;
+    struct ecu_serve_idle old;
+    struct ecu_ctx *ctx = NULL;
+    unsigned int i;
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    while( 1 )
+    {
+        for( i = ecu_serve_idle_cnt ; i > 0 ; i-- )
+        {
+            idle = &ecu_serve_idle_list[i - 1];
+            if( (idle->key_size == key_size) && (memcmp(idle->key, key, key_size) == 0) )
+            {
+                ctx = idle->ctx;
+                free(idle->key);
+                memmove(idle, idle + 1, (ecu_serve_idle_cnt - i) * sizeof(*idle));
+                ecu_serve_idle_cnt--;
+                pthread_mutex_unlock(&ecu_serve_lock);
+                return ctx;
+            }
+        }
+
+        /* pool of new context is counted as largest one until it is built */
+        if( (ecu_serve_ctx_cnt < ecu_serve_ctx_max) &&
+            (ecu_serve_pool_used + ECU_POOL_MAX_SIZE <= ECU_SERVE_POOL_BUDGET) )
+        {
+            ecu_serve_ctx_cnt++;
+            ecu_serve_pool_used += ECU_POOL_MAX_SIZE;
+            break;
+        }
+
+        if( ecu_serve_idle_cnt > 0 )
+        {
+            old = ecu_serve_idle_list[0];
+            memmove(&ecu_serve_idle_list[0], &ecu_serve_idle_list[1],
+                    (ecu_serve_idle_cnt - 1) * sizeof(struct ecu_serve_idle));
+            ecu_serve_idle_cnt--;
+            pthread_mutex_unlock(&ecu_serve_lock);
+
+            ecu_serve_drop_ctx(old.ctx);
+            free(old.key);
+            pthread_mutex_lock(&ecu_serve_lock);
+            continue;
+        }
+
+        pthread_cond_wait(&ecu_serve_free, &ecu_serve_lock);
+    }
+    pthread_mutex_unlock(&ecu_serve_lock);
+
+    ctx = ecu_create(key, key_size, &ecu_serve_cfg);
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    ecu_serve_pool_used -= ECU_POOL_MAX_SIZE;
+    if( ctx )
+    {
+        ecu_serve_pool_used += ctx->pool.arena_size;
+    }
+    else
+    {
+        ecu_serve_ctx_cnt--;
+    }
+    pthread_cond_broadcast(&ecu_serve_free);
+    pthread_mutex_unlock(&ecu_serve_lock);
+
+    return ctx;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_put_ctx
+ **
+ ** Description     keep context for next stream of key.
+ **                 oldest idle context is destroyed when list is full
+ **
+ ** Parameters      ctx : context
+ **                 key : key data, owned by list from now on
+ **                 key_size : size of key
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_serve_put_ctx(struct ecu_ctx *ctx, unsigned char *key, size_t key_size)
+{
+    struct ecu_serve_idle old = { NULL, NULL, 0 };
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    if( ecu_serve_idle_cnt == ECU_SERVE_MAX_IDLE )
+    {
+        old = ecu_serve_idle_list[0];
+        memmove(&ecu_serve_idle_list[0], &ecu_serve_idle_list[1],
+                (ECU_SERVE_MAX_IDLE - 1) * sizeof(struct ecu_serve_idle));
+        ecu_serve_idle_cnt--;
+    }
+    ecu_serve_idle_list[ecu_serve_idle_cnt].ctx = ctx;
+    ecu_serve_idle_list[ecu_serve_idle_cnt].key = key;
+    ecu_serve_idle_list[ecu_serve_idle_cnt].key_size = key_size;
+    ecu_serve_idle_cnt++;
+
+    /* stream waiting for budget may take this context or evict it */
+    pthread_cond_broadcast(&ecu_serve_free);
+    pthread_mutex_unlock(&ecu_serve_lock);
+
+    /* freeing blocks of a context takes a while, out of lock */
+    if( old.ctx )
+    {
+        ecu_serve_drop_ctx(old.ctx);
+    }
+    free(old.key);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_drop_ctx
+ **
+ ** Description     destroy context and give its budget back
+ **
+ ** Parameters      ctx : context
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_serve_drop_ctx(struct ecu_ctx *ctx)
+{
+    size_t pool_size = ctx->pool.arena_size;
+
+    ecu_destroy(ctx);
+
+    pthread_mutex_lock(&ecu_serve_lock);
+    ecu_serve_ctx_cnt--;
+    ecu_serve_pool_used -= pool_size;
+    pthread_cond_broadcast(&ecu_serve_free);
+    pthread_mutex_unlock(&ecu_serve_lock);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve_reply
+ **
+ ** Description     send status of stream header
+ **
+ ** Parameters      fd : socket of client
+ **                 status : ECU_SERVE_xxx
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int ecu_serve_reply(int fd, uint32_t status)
+{
+    return ecu_io_write(fd, (const unsigned char *)&status, sizeof(status));
+}
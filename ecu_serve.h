@@ -0,0 +1,37 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_SERVE_H
+#define ECU_SERVE_H
+
+#include "ecu.h"
+
+/* Maximum streams connected at once, running or waiting for budget,
+ * more are refused with ECU_SERVE_BUSY
+ */
+#define ECU_SERVE_MAX_STREAM 64
+
+/* Maximum idle contexts kept warm for next streams */
+#define ECU_SERVE_MAX_IDLE 8
+
+/* Block pools of all contexts, running and idle (byte) */
+#define ECU_SERVE_POOL_BUDGET (1024*1024*1024)
+
+/*******************************************************************************
+ **
+ ** Function        ecu_serve
+ **
+ ** Description     run daemon on a Unix socket until SIGINT or SIGTERM.
+ **                 each stream gets a context of its key, idle contexts
+ **                 with keystream, block pool, rings and parked threads
+ **                 are kept for next streams of the same key.
+ **                 contexts share budget of encryptor threads and pools
+ **
+ ** Parameters      path : Unix socket
+ **                 cfg : configuration of every context
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_serve(const char *path, const struct ecu_config *cfg);
+
+#endif
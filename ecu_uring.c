@@ -0,0 +1,347 @@
+/*****************************************************************************
+**
+**  Name:           ecu_uring.c
+**
+**  Description:    minimal io_uring on raw system calls.
+**                  keeps many reads or writes in flight
+**                  without liburing.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "ecu_uring.h"
+
+
+
+#ifdef __NR_io_uring_setup
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_init
+ **
+ ** Description     create io_uring and map its rings
+ **
+ ** Parameters      ring : io_uring
+ **                 entries : number of submission entries
+ **
+ ** Returns         0 is success
+ **                 -1 is error, io_uring is not available
+ **
+ *******************************************************************************/
+int ecu_uring_init(struct ecu_uring *ring, unsigned int entries)
+{
+    struct io_uring_params p;
+    unsigned char *sq, *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+
+    /* kernel, seccomp or sysctl may not allow io_uring */
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if( ring->fd < 0 )
+    {
+#ifdef DEBUG
+        printf("io_uring_setup error %d\n", errno);
+#endif
+        return -1;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if( (ring->sq_ptr == MAP_FAILED) || (ring->cq_ptr == MAP_FAILED) ||
+        (ring->sqes == MAP_FAILED) )
+    {
+        fprintf(stderr, "io_uring mmap error %d\n", errno);
+        ecu_uring_exit(ring);
+        return -1;
+    }
+
+    sq = ring->sq_ptr;
+    cq = ring->cq_ptr;
+    ring->sq_head = (unsigned int *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned int *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    ring->sq_entries = p.sq_entries;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_exit
+ **
+ ** Description     unmap rings and close io_uring
+ **
+ ** Parameters      ring : io_uring
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_uring_exit(struct ecu_uring *ring)
+{
+    if( ring->sq_ptr && (ring->sq_ptr != MAP_FAILED) )
+    {
+        munmap(ring->sq_ptr, ring->sq_len);
+    }
+    if( ring->cq_ptr && (ring->cq_ptr != MAP_FAILED) )
+    {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    if( ring->sqes && ((void *)ring->sqes != MAP_FAILED) )
+    {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if( ring->fd >= 0 )
+    {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_register
+ **
+ ** Description     register memory as fixed buffer. requests inside it
+ **                 use fixed read/write without page pinning per request
+ **
+ ** Parameters      ring : io_uring
+ **                 base : start of memory
+ **                 len : length of memory
+ **
+ ** Returns         0 is success
+ **                 -1 is error, plain read/write is used
+ **
+ *******************************************************************************/
+int ecu_uring_register(struct ecu_uring *ring, void *base, size_t len)
+{
+    struct iovec iov;
+
+    iov.iov_base = base;
+    iov.iov_len = len;
+
+    /* pinned memory is limited by RLIMIT_MEMLOCK */
+    if( syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0 )
+    {
+#ifdef DEBUG
+        printf("io_uring_register error %d\n", errno);
+#endif
+        return -1;
+    }
+    ring->buf_base = base;
+    ring->buf_len = len;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_prep
+ **
+ ** Description     prepare one read or write request
+ **
+ ** Parameters      ring : io_uring
+ **                 write : 1 is write, 0 is read
+ **                 fd : file descriptor
+ **                 buf : data buffer
+ **                 len : length of data
+ **                 offset : file offset
+ **                 user : pointer returned with result
+ **
+ ** Returns         0 is success
+ **                 -1 is submission queue full
+ **
+ *******************************************************************************/
+int ecu_uring_prep(struct ecu_uring *ring, int write, int fd, void *buf,
+                   unsigned int len, unsigned long long offset, void *user)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail, idx;
+
+    /* completion queue is twice of submission queue,
+     * keeping inflight within sq entries never overflows it
+     */
+    if( ring->inflight >= ring->sq_entries )
+    {
+        return -1;
+    }
+
+    tail = *ring->sq_tail;
+    idx = tail & *ring->sq_mask;
+    sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->user_data = (unsigned long)user;
+
+    if( ring->buf_base && ((unsigned char *)buf >= ring->buf_base) &&
+        ((unsigned char *)buf + len <= ring->buf_base + ring->buf_len) )
+    {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+
+    ring->sq_array[idx] = idx;
+    /* kernel reads sqe after it sees new tail */
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    ring->inflight++;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_submit
+ **
+ ** Description     submit prepared requests and wait for completions
+ **
+ ** Parameters      ring : io_uring
+ **                 wait_nr : number of completions to wait for
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_uring_submit(struct ecu_uring *ring, unsigned int wait_nr)
+{
+    int result;
+
+    if( (ring->to_submit == 0) && (wait_nr == 0) )
+    {
+        return 0;
+    }
+
+    while(1)
+    {
+        result = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait_nr,
+                         wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if( result >= 0 )
+        {
+            ring->to_submit -= (unsigned int)result;
+            /* kernel may take part of queue, push the rest */
+            if( (ring->to_submit == 0) || (wait_nr > 0) )
+            {
+                break;
+            }
+            continue;
+        }
+        if( (errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY) )
+        {
+            /* completions are reaped by caller, enough to retry */
+            if( errno != EINTR )
+            {
+                wait_nr = 0;
+            }
+            continue;
+        }
+        fprintf(stderr, "io_uring_enter error %d\n", errno);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_reap
+ **
+ ** Description     take one completion without waiting
+ **
+ ** Parameters      ring : io_uring
+ **                 user : user pointer of request
+ **                 res : result of request, bytes or -errno
+ **
+ ** Returns         1 is a completion is taken
+ **                 0 is no completion
+ **
+ *******************************************************************************/
+int ecu_uring_reap(struct ecu_uring *ring, void **user, int *res)
+{
+    struct io_uring_cqe *cqe;
+    unsigned int head;
+
+    head = *ring->cq_head;
+    if( head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) )
+    {
+        return 0;
+    }
+
+    cqe = &ring->cqes[head & *ring->cq_mask];
+    *user = (void *)(unsigned long)cqe->user_data;
+    *res = cqe->res;
+
+    /* give cqe back to kernel */
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    ring->inflight--;
+
+    return 1;
+}
+
+#else /* __NR_io_uring_setup */
+
+int ecu_uring_init(struct ecu_uring *ring, unsigned int entries)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    return -1;
+}
+
+void ecu_uring_exit(struct ecu_uring *ring)
+{
+}
+
+int ecu_uring_register(struct ecu_uring *ring, void *base, size_t len)
+{
+    return -1;
+}
+
+int ecu_uring_prep(struct ecu_uring *ring, int write, int fd, void *buf,
+                   unsigned int len, unsigned long long offset, void *user)
+{
+    return -1;
+}
+
+int ecu_uring_submit(struct ecu_uring *ring, unsigned int wait_nr)
+{
+    return -1;
+}
+
+int ecu_uring_reap(struct ecu_uring *ring, void **user, int *res)
+{
+    return 0;
+}
+
+#endif /* __NR_io_uring_setup */
@@ -0,0 +1,139 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_URING_H
+#define ECU_URING_H
+
+#include <stddef.h>
+
+/* Number of requests in flight of io_uring engine */
+#define ECU_URING_DEPTH 64
+
+/* minimal io_uring on raw system calls, one submitter thread per ring.
+ * user pointer of each request is returned with its result
+ */
+struct ecu_uring
+{
+    int fd;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned int sq_entries;
+    unsigned int to_submit;     /* prepared, not yet submitted */
+    unsigned int inflight;      /* submitted or prepared, not yet reaped */
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned char *buf_base;    /* registered buffer, NULL if none */
+    size_t buf_len;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_init
+ **
+ ** Description     create io_uring and map its rings
+ **
+ ** Parameters      ring : io_uring
+ **                 entries : number of submission entries
+ **
+ ** Returns         0 is success
+ **                 -1 is error, io_uring is not available
+ **
+ *******************************************************************************/
+int ecu_uring_init(struct ecu_uring *ring, unsigned int entries);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_exit
+ **
+ ** Description     unmap rings and close io_uring
+ **
+ ** Parameters      ring : io_uring
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_uring_exit(struct ecu_uring *ring);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_register
+ **
+ ** Description     register memory as fixed buffer. requests inside it
+ **                 use fixed read/write without page pinning per request
+ **
+ ** Parameters      ring : io_uring
+ **                 base : start of memory
+ **                 len : length of memory
+ **
+ ** Returns         0 is success
+ **                 -1 is error, plain read/write is used
+ **
+ *******************************************************************************/
+int ecu_uring_register(struct ecu_uring *ring, void *base, size_t len);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_prep
+ **
+ ** Description     prepare one read or write request
+ **
+ ** Parameters      ring : io_uring
+ **                 write : 1 is write, 0 is read
+ **                 fd : file descriptor
+ **                 buf : data buffer
+ **                 len : length of data
+ **                 offset : file offset
+ **                 user : pointer returned with result
+ **
+ ** Returns         0 is success
+ **                 -1 is submission queue full
+ **
+ *******************************************************************************/
+int ecu_uring_prep(struct ecu_uring *ring, int write, int fd, void *buf,
+                   unsigned int len, unsigned long long offset, void *user);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_submit
+ **
+ ** Description     submit prepared requests and wait for completions
+ **
+ ** Parameters      ring : io_uring
+ **                 wait_nr : number of completions to wait for
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_uring_submit(struct ecu_uring *ring, unsigned int wait_nr);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_uring_reap
+ **
+ ** Description     take one completion without waiting
+ **
+ ** Parameters      ring : io_uring
+ **                 user : user pointer of request
+ **                 res : result of request, bytes or -errno
+ **
+ ** Returns         1 is a completion is taken
+ **                 0 is no completion
+ **
+ *******************************************************************************/
+int ecu_uring_reap(struct ecu_uring *ring, void **user, int *res);
+
+#endif
@@ -0,0 +1,232 @@
+/*****************************************************************************
+**
+**  Name:           ecu_wait.c
+**
+**  Description:    wait strategy for threads of pipeline.
+**                  spin, spin then sleep on futex, or sleep on futex
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "ecu_wait.h"
+
+
+/* static function definitions */
+static void ecu_wait_cpu_relax();
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_init
+ **
+ ** Description     init wait event
+ **
+ ** Parameters      w : wait event
+ **                 mode : ECU_WAIT_SPIN, ECU_WAIT_HYBRID or ECU_WAIT_BLOCK
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_init(struct ecu_wait *w, unsigned int mode)
+{
+    atomic_init(&w->seq, 0);
+    atomic_init(&w->waiters, 0);
+    w->mode = mode;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_spin
+ **
+ ** Description     back off once before condition is checked again
+ **
+ ** Parameters      w : wait event
+ **                 spin : spin counter of caller, 0 at first call
+ **
+ ** Returns         0 is keep spinning
+ **                 1 is spin budget is used up, sleep with
+ **                 ecu_wait_prepare/commit
+ **
+ *******************************************************************************/
+int ecu_wait_spin(struct ecu_wait *w, unsigned int *spin)
+{
+    if( w->mode == ECU_WAIT_BLOCK )
+    {
+        return 1;
+    }
+
+    (*spin)++;
+    if( *spin > ECU_WAIT_SPIN_CNT )
+    {
+        *spin = 0;
+        return 1;
+    }
+
+    /* give CPU to other threads from time to time when oversubscribed */
+    if( (*spin % 64) == 0 )
+    {
+        sched_yield();
+    }
+    else
+    {
+        ecu_wait_cpu_relax();
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_prepare
+ **
+ ** Description     announce waiter. condition must be checked again
+ **                 after this, then call ecu_wait_commit or ecu_wait_cancel
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         key for ecu_wait_commit
+ **
+ *******************************************************************************/
+unsigned int ecu_wait_prepare(struct ecu_wait *w)
+{
+    if( w->mode == ECU_WAIT_SPIN )
+    {
+        return 0;
+    }
+    atomic_fetch_add(&w->waiters, 1);
+    return atomic_load(&w->seq);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_commit
+ **
+ ** Description     sleep until event is signaled.
+ **                 returns at once if it was signaled after prepare.
+ **                 spin strategy never sleeps
+ **
+ ** Parameters      w : wait event
+ **                 key : return value of ecu_wait_prepare
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_commit(struct ecu_wait *w, unsigned int key)
+{
+    if( w->mode == ECU_WAIT_SPIN )
+    {
+        return;
+    }
+    /* kernel compares seq with key, so a signal after prepare is not lost */
+    syscall(SYS_futex, &w->seq, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+    atomic_fetch_sub(&w->waiters, 1);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_cancel
+ **
+ ** Description     withdraw waiter, condition became true
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_cancel(struct ecu_wait *w)
+{
+    if( w->mode == ECU_WAIT_SPIN )
+    {
+        return;
+    }
+    atomic_fetch_sub(&w->waiters, 1);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_signal
+ **
+ ** Description     wake all waiters. costs only a memory fence
+ **                 when nobody waits
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_signal(struct ecu_wait *w)
+{
+    /* condition change must be visible before waiters is read,
+     * pairs with fetch_add in ecu_wait_prepare
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    if( atomic_load_explicit(&w->waiters, memory_order_relaxed) == 0 )
+    {
+        return;
+    }
+
+    atomic_fetch_add(&w->seq, 1);
+    syscall(SYS_futex, &w->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_parse_mode
+ **
+ ** Description     convert name of wait strategy to ECU_WAIT_xxx
+ **
+ ** Parameters      name : "spin", "hybrid" or "block"
+ **
+ ** Returns         ECU_WAIT_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_wait_parse_mode(const char *name)
+{
+    if( strcmp(name, "spin") == 0 )
+    {
+        return ECU_WAIT_SPIN;
+    }
+    if( strcmp(name, "hybrid") == 0 )
+    {
+        return ECU_WAIT_HYBRID;
+    }
+    if( strcmp(name, "block") == 0 )
+    {
+        return ECU_WAIT_BLOCK;
+    }
+    return -1;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_cpu_relax
+ **
+ ** Description     hint to CPU that this is a spin loop
+ **
+ ** Parameters      none
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_wait_cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
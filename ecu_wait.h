@@ -0,0 +1,132 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_WAIT_H
+#define ECU_WAIT_H
+
+#include <stdatomic.h>
+
+/* wait strategy ECU_WAIT_xxx */
+#include "ecu.h"
+
+/* number of spins before hybrid waiter sleeps */
+#define ECU_WAIT_SPIN_CNT 1000
+
+/* event a thread can wait for.
+ * waiter : key = ecu_wait_prepare(), re-check condition,
+ *          then ecu_wait_commit(key) or ecu_wait_cancel()
+ * signaler : change condition, then ecu_wait_signal()
+ */
+struct ecu_wait
+{
+    atomic_uint seq;        /* futex word, changes on every signal */
+    atomic_uint waiters;    /* number of threads in prepare..commit */
+    unsigned int mode;      /* ECU_WAIT_xxx */
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_init
+ **
+ ** Description     init wait event
+ **
+ ** Parameters      w : wait event
+ **                 mode : ECU_WAIT_SPIN, ECU_WAIT_HYBRID or ECU_WAIT_BLOCK
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_init(struct ecu_wait *w, unsigned int mode);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_spin
+ **
+ ** Description     back off once before condition is checked again
+ **
+ ** Parameters      w : wait event
+ **                 spin : spin counter of caller, 0 at first call
+ **
+ ** Returns         0 is keep spinning
+ **                 1 is spin budget is used up, sleep with
+ **                 ecu_wait_prepare/commit
+ **
+ *******************************************************************************/
+int ecu_wait_spin(struct ecu_wait *w, unsigned int *spin);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_prepare
+ **
+ ** Description     announce waiter. condition must be checked again
+ **                 after this, then call ecu_wait_commit or ecu_wait_cancel
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         key for ecu_wait_commit
+ **
+ *******************************************************************************/
+unsigned int ecu_wait_prepare(struct ecu_wait *w);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_commit
+ **
+ ** Description     sleep until event is signaled.
+ **                 returns at once if it was signaled after prepare.
+ **                 spin strategy never sleeps
+ **
+ ** Parameters      w : wait event
+ **                 key : return value of ecu_wait_prepare
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_commit(struct ecu_wait *w, unsigned int key);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_cancel
+ **
+ ** Description     withdraw waiter, condition became true
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_cancel(struct ecu_wait *w);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_signal
+ **
+ ** Description     wake all waiters. costs only a memory fence
+ **                 when nobody waits
+ **
+ ** Parameters      w : wait event
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_wait_signal(struct ecu_wait *w);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_wait_parse_mode
+ **
+ ** Description     convert name of wait strategy to ECU_WAIT_xxx
+ **
+ ** Parameters      name : "spin", "hybrid" or "block"
+ **
+ ** Returns         ECU_WAIT_xxx
+ **                 -1 is unknown name
+ **
+ *******************************************************************************/
+int ecu_wait_parse_mode(const char *name);
+
+#endif
@@ -0,0 +1,242 @@
+/*****************************************************************************
+**
+**  Name:           ecu_worker.c
+**
+**  Description:    threads parked between runs of a context.
+**                  distributor, encryptor and merger of a run are jobs
+**                  handed to parked threads instead of new threads,
+**                  so a run of a warm context creates no thread
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "ecu_worker.h"
+
+
+/* static function definitions */
+static void *ecu_worker_thread(void *ptr);
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_init
+ **
+ ** Description     init workers. threads are created by first jobs
+ **
+ ** Parameters      ws : workers
+ **                 num : number of workers, 0 is a thread per job
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_worker_init(struct ecu_workers *ws, unsigned int num)
+{
+    unsigned int i;
+
+    ws->w = NULL;
+    ws->num = 0;
+    if( num == 0 )
+    {
+        return 0;
+    }
+
+    ws->w = calloc(num, sizeof(struct ecu_worker));
+    if( ws->w == NULL )
+    {
+        fprintf(stderr, "worker alloc error!\n");
+        return -1;
+    }
+    for( i = 0 ; i < num ; i++ )
+    {
+        pthread_mutex_init(&ws->w[i].lock, NULL);
+        pthread_cond_init(&ws->w[i].cond, NULL);
+        ws->w[i].state = ECU_WORKER_IDLE;
+    }
+    ws->num = num;
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_create
+ **
+ ** Description     run a job on an idle worker, like pthread_create().
+ **                 a new thread runs it if no worker is idle
+ **
+ ** Parameters      ws : workers
+ **                 tid : thread of job, for ecu_worker_join
+ **                 fn : job
+ **                 arg : argument of job
+ **
+ ** Returns         0 is success
+ **                 the others are errors
+ **
+ *******************************************************************************/
+int ecu_worker_create(struct ecu_workers *ws, pthread_t *tid,
+                      void *(*fn)(void *), void *arg)
+{
+    struct ecu_worker *w;
+    unsigned int i;
+    int result;
+
+    for( i = 0 ; i < ws->num ; i++ )
+    {
+        w = &ws->w[i];
+        pthread_mutex_lock(&w->lock);
+        if( w->state != ECU_WORKER_IDLE )
+        {
+            pthread_mutex_unlock(&w->lock);
+            continue;
+        }
+
+        w->fn = fn;
+        w->arg = arg;
+        w->state = ECU_WORKER_RUN;
+        if( w->started == 0 )
+        {
+            result = pthread_create(&w->tid, NULL, ecu_worker_thread, w);
+            if( result )
+            {
+                w->state = ECU_WORKER_IDLE;
+                pthread_mutex_unlock(&w->lock);
+                return result;
+            }
+            w->started = 1;
+        }
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+
+        *tid = w->tid;
+        return 0;
+    }
+
+    return pthread_create(tid, NULL, fn, arg);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_join
+ **
+ ** Description     wait for a job to return, like pthread_join().
+ **                 its worker is parked for next job
+ **
+ ** Parameters      ws : workers
+ **                 tid : thread of job
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_worker_join(struct ecu_workers *ws, pthread_t tid)
+{
+    struct ecu_worker *w;
+    unsigned int i;
+
+    for( i = 0 ; i < ws->num ; i++ )
+    {
+        w = &ws->w[i];
+        if( (w->started == 0) || (pthread_equal(w->tid, tid) == 0) )
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&w->lock);
+        while( w->state == ECU_WORKER_RUN )
+        {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        w->state = ECU_WORKER_IDLE;
+        pthread_mutex_unlock(&w->lock);
+        return;
+    }
+
+    pthread_join(tid, NULL);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_destroy
+ **
+ ** Description     stop every worker thread and free workers.
+ **                 no job may be running
+ **
+ ** Parameters      ws : workers
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_worker_destroy(struct ecu_workers *ws)
+{
+    struct ecu_worker *w;
+    unsigned int i;
+
+    for( i = 0 ; i < ws->num ; i++ )
+    {
+        w = &ws->w[i];
+        if( w->started )
+        {
+            pthread_mutex_lock(&w->lock);
+            w->state = ECU_WORKER_EXIT;
+            pthread_cond_broadcast(&w->cond);
+            pthread_mutex_unlock(&w->lock);
+            pthread_join(w->tid, NULL);
+        }
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+    }
+    free(ws->w);
+    ws->w = NULL;
+    ws->num = 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_thread
+ **
+ ** Description     run jobs until asked to exit, parked in between
+ **
+ ** Parameters      ptr : worker
+ **
+ ** Returns         NULL
+ **
+ *******************************************************************************/
+static void *ecu_worker_thread(void *ptr)
+{
+    struct ecu_worker *w = ptr;
+    void *(*fn)(void *);
+    void *arg;
+
+    pthread_mutex_lock(&w->lock);
+    while( 1 )
+    {
+        while( (w->state != ECU_WORKER_RUN) && (w->state != ECU_WORKER_EXIT) )
+        {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if( w->state == ECU_WORKER_EXIT )
+        {
+            break;
+        }
+        fn = w->fn;
+        arg = w->arg;
+        pthread_mutex_unlock(&w->lock);
+
+        fn(arg);
+
+        pthread_mutex_lock(&w->lock);
+        w->state = ECU_WORKER_DONE;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
@@ -0,0 +1,100 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_WORKER_H
+#define ECU_WORKER_H
+
+#include <pthread.h>
+
+/* state of a worker */
+#define ECU_WORKER_IDLE 0   /* parked, waiting for a job */
+#define ECU_WORKER_RUN  1   /* running a job */
+#define ECU_WORKER_DONE 2   /* job returned, not joined yet */
+#define ECU_WORKER_EXIT 3   /* thread is asked to exit */
+
+/* thread kept alive between runs of a context, one job at a time */
+struct ecu_worker
+{
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    void *(*fn)(void *);    /* job */
+    void *arg;
+    unsigned int state;     /* ECU_WORKER_xxx */
+    unsigned int started;   /* 1 if thread exists */
+};
+
+/* parked threads of a context.
+ * with no worker, every job gets its own thread
+ */
+struct ecu_workers
+{
+    struct ecu_worker *w;
+    unsigned int num;
+};
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_init
+ **
+ ** Description     init workers. threads are created by first jobs
+ **
+ ** Parameters      ws : workers
+ **                 num : number of workers, 0 is a thread per job
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+int ecu_worker_init(struct ecu_workers *ws, unsigned int num);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_create
+ **
+ ** Description     run a job on an idle worker, like pthread_create().
+ **                 a new thread runs it if no worker is idle
+ **
+ ** Parameters      ws : workers
+ **                 tid : thread of job, for ecu_worker_join
+ **                 fn : job
+ **                 arg : argument of job
+ **
+ ** Returns         0 is success
+ **                 the others are errors
+ **
+ *******************************************************************************/
+int ecu_worker_create(struct ecu_workers *ws, pthread_t *tid,
+                      void *(*fn)(void *), void *arg);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_join
+ **
+ ** Description     wait for a job to return, like pthread_join().
+ **                 its worker is parked for next job
+ **
+ ** Parameters      ws : workers
+ **                 tid : thread of job
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_worker_join(struct ecu_workers *ws, pthread_t tid);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_worker_destroy
+ **
+ ** Description     stop every worker thread and free workers.
+ **                 no job may be running
+ **
+ ** Parameters      ws : workers
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_worker_destroy(struct ecu_workers *ws);
+
+#endif
@@ -0,0 +1,460 @@
+/*****************************************************************************
+**
+**  Name:           ecu_xor.c
+**
+**  Description:    XOR kernels for encryptor.
+**                  scalar, SSE2, AVX2 and AVX-512 kernels.
+**                  fastest kernel is selected at startup with cpuid.
+**   Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#define ECU_XOR_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "ecu_xor.h"
+
+
+/* static function definitions */
+static void ecu_xor_scalar(unsigned char *dst, const unsigned char *src,
+                           const unsigned char *ks, unsigned int len);
+#ifdef ECU_XOR_X86
+static void ecu_xor_sse2(unsigned char *dst, const unsigned char *src,
+                         const unsigned char *ks, unsigned int len);
+static void ecu_xor_avx2(unsigned char *dst, const unsigned char *src,
+                         const unsigned char *ks, unsigned int len);
+static void ecu_xor_avx512(unsigned char *dst, const unsigned char *src,
+                           const unsigned char *ks, unsigned int len);
+static unsigned int ecu_xor_cpu_flags();
+#endif
+static void ecu_xor_select();
+
+
+/* cpu feature flags */
+#define ECU_XOR_CPU_SSE2    0x01
+#define ECU_XOR_CPU_AVX2    0x02
+#define ECU_XOR_CPU_AVX512  0x04
+
+/* kernel table, fastest last */
+struct ecu_xor_kernel {
+    const char *name;
+    ecu_xor_fn fn;
+    unsigned int cpu_flag;
+};
+
+static const struct ecu_xor_kernel ECU_XOR_KERNELS[] = {
+    { "scalar", ecu_xor_scalar, 0 },
+#ifdef ECU_XOR_X86
+    { "sse2",   ecu_xor_sse2,   ECU_XOR_CPU_SSE2 },
+    { "avx2",   ecu_xor_avx2,   ECU_XOR_CPU_AVX2 },
+    { "avx512", ecu_xor_avx512, ECU_XOR_CPU_AVX512 },
+#endif
+};
+
+#define ECU_XOR_KERNEL_NUM (sizeof(ECU_XOR_KERNELS)/sizeof(ECU_XOR_KERNELS[0]))
+
+/* selected kernel, same for every context of process */
+static const struct ecu_xor_kernel *ecu_xor_selected = &ECU_XOR_KERNELS[0];
+static pthread_once_t ecu_xor_once = PTHREAD_ONCE_INIT;
+
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_init
+ **
+ ** Description     select fastest XOR kernel supported by this CPU.
+ **                 must be called before encryptor threads start.
+ **                 kernel is selected once, any thread may call it
+ **
+ ** Parameters      none
+ **
+ ** Returns         0 is success
+ **
+ *******************************************************************************/
+int ecu_xor_init()
+{
+    pthread_once(&ecu_xor_once, ecu_xor_select);
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_select
+ **
+ ** Description     select fastest XOR kernel supported by this CPU
+ **
+ ** Parameters      none
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_xor_select()
+{
+    unsigned int i;
+    unsigned int flags = 0;
+
+#ifdef ECU_XOR_X86
+    flags = ecu_xor_cpu_flags();
+#endif
+
+    ecu_xor_selected = &ECU_XOR_KERNELS[0];
+    for( i = 1 ; i < ECU_XOR_KERNEL_NUM ; i++ )
+    {
+        if( (flags & ECU_XOR_KERNELS[i].cpu_flag) == ECU_XOR_KERNELS[i].cpu_flag )
+        {
+            ecu_xor_selected = &ECU_XOR_KERNELS[i];
+        }
+    }
+
+#ifdef DEBUG
+    printf("xor kernel : %s\n", ecu_xor_selected->name);
+#endif
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_block
+ **
+ ** Description     XOR data with keystream using selected kernel
+ **
+ ** Parameters      dst : output buffer (can be same as src)
+ **                 src : input data
+ **                 ks : keystream
+ **                 len : length of data
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_xor_block(unsigned char *dst, const unsigned char *src,
+                   const unsigned char *ks, unsigned int len)
+{
+    ecu_xor_selected->fn(dst, src, ks, len);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_get_name
+ **
+ ** Description     get name of selected XOR kernel
+ **
+ ** Parameters      none
+ **
+ ** Returns         "scalar", "sse2", "avx2" or "avx512"
+ **
+ *******************************************************************************/
+const char *ecu_xor_get_name()
+{
+    return ecu_xor_selected->name;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_get_kernel
+ **
+ ** Description     get XOR kernel by name
+ **
+ ** Parameters      name : "scalar", "sse2", "avx2" or "avx512"
+ **
+ ** Returns         kernel function
+ **                 NULL if unknown or not supported by this CPU
+ **
+ *******************************************************************************/
+ecu_xor_fn ecu_xor_get_kernel(const char *name)
+{
+    unsigned int i;
+    unsigned int flags = 0;
+
+#ifdef ECU_XOR_X86
+    flags = ecu_xor_cpu_flags();
+#endif
+
+    for( i = 0 ; i < ECU_XOR_KERNEL_NUM ; i++ )
+    {
+        if( strcmp(name, ECU_XOR_KERNELS[i].name) == 0 )
+        {
+            if( (flags & ECU_XOR_KERNELS[i].cpu_flag) != ECU_XOR_KERNELS[i].cpu_flag )
+            {
+                return NULL;
+            }
+            return ECU_XOR_KERNELS[i].fn;
+        }
+    }
+    return NULL;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_key_rotate
+ **
+ ** Description     rotate whole key left by 0 to 7 bits.
+ **                 key[0] is the lowest byte, bits carry from key[j] into
+ **                 key[j+1] and from the last byte back into key[0].
+ **                 8 bytes are done at once as a little endian word,
+ **                 whose shift already carries bits between its bytes
+ **
+ ** Parameters      dst : rotated key, len bytes
+ **                 key : original key
+ **                 len : key size
+ **                 bits : rotation, 0 to 7
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_xor_key_rotate(unsigned char *dst, const unsigned char *key,
+                        unsigned int len, unsigned int bits)
+{
+    uint64_t word;
+    unsigned int j;
+
+    if( bits == 0 )
+    {
+        memcpy(dst, key, len);
+        return;
+    }
+
+    /* first byte takes carry of the last one */
+    dst[0] = (unsigned char)((key[0] << bits) | (key[len - 1] >> (8 - bits)));
+
+    for( j = 1 ; j + 8 <= len ; j += 8 )
+    {
+        memcpy(&word, &key[j], 8);
+        word = (le64toh(word) << bits) | (key[j - 1] >> (8 - bits));
+        word = htole64(word);
+        memcpy(&dst[j], &word, 8);
+    }
+
+    for( ; j < len ; j++ )
+    {
+        dst[j] = (unsigned char)((key[j] << bits) | (key[j - 1] >> (8 - bits)));
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_scalar
+ **
+ ** Description     reference XOR kernel, one byte at a time
+ **
+ ** Parameters      dst, src, ks, len
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+static void ecu_xor_scalar(unsigned char *dst, const unsigned char *src,
+                           const unsigned char *ks, unsigned int len)
+{
+    unsigned int i;
+
+    for( i = 0 ; i < len ; i++ )
+    {
+        dst[i] = src[i] ^ ks[i];
+    }
+}
+
+
+#ifdef ECU_XOR_X86
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_sse2
+ **
+ ** Description     SSE2 XOR kernel, 16 bytes at a time
+ **
+ ** Parameters      dst, src, ks, len
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+__attribute__((target("sse2")))
+static void ecu_xor_sse2(unsigned char *dst, const unsigned char *src,
+                         const unsigned char *ks, unsigned int len)
+{
+    unsigned int i = 0;
+    __m128i a, b;
+
+    for( ; i + 64 <= len ; i += 64 )
+    {
+        a = _mm_loadu_si128((const __m128i *)(src + i));
+        b = _mm_loadu_si128((const __m128i *)(ks + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+        a = _mm_loadu_si128((const __m128i *)(src + i + 16));
+        b = _mm_loadu_si128((const __m128i *)(ks + i + 16));
+        _mm_storeu_si128((__m128i *)(dst + i + 16), _mm_xor_si128(a, b));
+        a = _mm_loadu_si128((const __m128i *)(src + i + 32));
+        b = _mm_loadu_si128((const __m128i *)(ks + i + 32));
+        _mm_storeu_si128((__m128i *)(dst + i + 32), _mm_xor_si128(a, b));
+        a = _mm_loadu_si128((const __m128i *)(src + i + 48));
+        b = _mm_loadu_si128((const __m128i *)(ks + i + 48));
+        _mm_storeu_si128((__m128i *)(dst + i + 48), _mm_xor_si128(a, b));
+    }
+    for( ; i + 16 <= len ; i += 16 )
+    {
+        a = _mm_loadu_si128((const __m128i *)(src + i));
+        b = _mm_loadu_si128((const __m128i *)(ks + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+    ecu_xor_scalar(dst + i, src + i, ks + i, len - i);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_avx2
+ **
+ ** Description     AVX2 XOR kernel, 32 bytes at a time
+ **
+ ** Parameters      dst, src, ks, len
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+__attribute__((target("avx2")))
+static void ecu_xor_avx2(unsigned char *dst, const unsigned char *src,
+                         const unsigned char *ks, unsigned int len)
+{
+    unsigned int i = 0;
+    __m256i a, b;
+
+    for( ; i + 128 <= len ; i += 128 )
+    {
+        a = _mm256_loadu_si256((const __m256i *)(src + i));
+        b = _mm256_loadu_si256((const __m256i *)(ks + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, b));
+        a = _mm256_loadu_si256((const __m256i *)(src + i + 32));
+        b = _mm256_loadu_si256((const __m256i *)(ks + i + 32));
+        _mm256_storeu_si256((__m256i *)(dst + i + 32), _mm256_xor_si256(a, b));
+        a = _mm256_loadu_si256((const __m256i *)(src + i + 64));
+        b = _mm256_loadu_si256((const __m256i *)(ks + i + 64));
+        _mm256_storeu_si256((__m256i *)(dst + i + 64), _mm256_xor_si256(a, b));
+        a = _mm256_loadu_si256((const __m256i *)(src + i + 96));
+        b = _mm256_loadu_si256((const __m256i *)(ks + i + 96));
+        _mm256_storeu_si256((__m256i *)(dst + i + 96), _mm256_xor_si256(a, b));
+    }
+    for( ; i + 32 <= len ; i += 32 )
+    {
+        a = _mm256_loadu_si256((const __m256i *)(src + i));
+        b = _mm256_loadu_si256((const __m256i *)(ks + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, b));
+    }
+    ecu_xor_scalar(dst + i, src + i, ks + i, len - i);
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_avx512
+ **
+ ** Description     AVX-512 XOR kernel, 64 bytes at a time.
+ **                 tail is handled with masked load/store
+ **
+ ** Parameters      dst, src, ks, len
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+__attribute__((target("avx512f,avx512bw")))
+static void ecu_xor_avx512(unsigned char *dst, const unsigned char *src,
+                           const unsigned char *ks, unsigned int len)
+{
+    unsigned int i = 0;
+    __m512i a, b;
+    __mmask64 mask;
+
+    for( ; i + 256 <= len ; i += 256 )
+    {
+        a = _mm512_loadu_si512((const void *)(src + i));
+        b = _mm512_loadu_si512((const void *)(ks + i));
+        _mm512_storeu_si512((void *)(dst + i), _mm512_xor_si512(a, b));
+        a = _mm512_loadu_si512((const void *)(src + i + 64));
+        b = _mm512_loadu_si512((const void *)(ks + i + 64));
+        _mm512_storeu_si512((void *)(dst + i + 64), _mm512_xor_si512(a, b));
+        a = _mm512_loadu_si512((const void *)(src + i + 128));
+        b = _mm512_loadu_si512((const void *)(ks + i + 128));
+        _mm512_storeu_si512((void *)(dst + i + 128), _mm512_xor_si512(a, b));
+        a = _mm512_loadu_si512((const void *)(src + i + 192));
+        b = _mm512_loadu_si512((const void *)(ks + i + 192));
+        _mm512_storeu_si512((void *)(dst + i + 192), _mm512_xor_si512(a, b));
+    }
+    for( ; i + 64 <= len ; i += 64 )
+    {
+        a = _mm512_loadu_si512((const void *)(src + i));
+        b = _mm512_loadu_si512((const void *)(ks + i));
+        _mm512_storeu_si512((void *)(dst + i), _mm512_xor_si512(a, b));
+    }
+    if( i < len )
+    {
+        mask = (__mmask64)(~0ULL >> (64 - (len - i)));
+        a = _mm512_maskz_loadu_epi8(mask, src + i);
+        b = _mm512_maskz_loadu_epi8(mask, ks + i);
+        _mm512_mask_storeu_epi8(dst + i, mask, _mm512_xor_si512(a, b));
+    }
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_cpu_flags
+ **
+ ** Description     detect SIMD features with cpuid.
+ **                 AVX states must also be enabled by OS (XGETBV)
+ **
+ ** Parameters      none
+ **
+ ** Returns         ECU_XOR_CPU_xxx flags
+ **
+ *******************************************************************************/
+static unsigned int ecu_xor_cpu_flags()
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_lo = 0, xcr0_hi = 0;
+    unsigned int flags = 0;
+
+    if( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) )
+    {
+        return 0;
+    }
+    if( edx & bit_SSE2 )
+    {
+        flags |= ECU_XOR_CPU_SSE2;
+    }
+
+    /* OS must save YMM/ZMM registers on context switch */
+    if( !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) )
+    {
+        return flags;
+    }
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+
+    if( !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) )
+    {
+        return flags;
+    }
+    /* XMM | YMM */
+    if( ((xcr0_lo & 0x06) == 0x06) && (ebx & bit_AVX2) )
+    {
+        flags |= ECU_XOR_CPU_AVX2;
+    }
+    /* XMM | YMM | opmask | ZMM_Hi256 | Hi16_ZMM */
+    if( ((xcr0_lo & 0xE6) == 0xE6) && (ebx & bit_AVX512F) &&
+        (ebx & bit_AVX512BW) )
+    {
+        flags |= ECU_XOR_CPU_AVX512;
+    }
+
+    return flags;
+}
+#endif
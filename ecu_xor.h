@@ -0,0 +1,95 @@
+// Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+#ifndef ECU_XOR_H
+#define ECU_XOR_H
+
+/* XOR kernel : dst[i] = src[i] ^ ks[i] for i < len
+ * dst may be the same buffer as src
+ */
+typedef void (*ecu_xor_fn)(unsigned char *dst, const unsigned char *src,
+                           const unsigned char *ks, unsigned int len);
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_init
+ **
+ ** Description     select fastest XOR kernel supported by this CPU.
+ **                 must be called before encryptor threads start.
+ **                 kernel is selected once, any thread may call it
+ **
+ ** Parameters      none
+ **
+ ** Returns         0 is success
+ **
+ *******************************************************************************/
+int ecu_xor_init();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_block
+ **
+ ** Description     XOR data with keystream using selected kernel
+ **
+ ** Parameters      dst : output buffer (can be same as src)
+ **                 src : input data
+ **                 ks : keystream
+ **                 len : length of data
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_xor_block(unsigned char *dst, const unsigned char *src,
+                   const unsigned char *ks, unsigned int len);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_get_name
+ **
+ ** Description     get name of selected XOR kernel
+ **
+ ** Parameters      none
+ **
+ ** Returns         "scalar", "sse2", "avx2" or "avx512"
+ **
+ *******************************************************************************/
+const char *ecu_xor_get_name();
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_get_kernel
+ **
+ ** Description     get XOR kernel by name
+ **
+ ** Parameters      name : "scalar", "sse2", "avx2" or "avx512"
+ **
+ ** Returns         kernel function
+ **                 NULL if unknown or not supported by this CPU
+ **
+ *******************************************************************************/
+ecu_xor_fn ecu_xor_get_kernel(const char *name);
+
+
+/*******************************************************************************
+ **
+ ** Function        ecu_xor_key_rotate
+ **
+ ** Description     rotate whole key left by 0 to 7 bits.
+ **                 key[0] is the lowest byte, bits carry from key[j] into
+ **                 key[j+1] and from the last byte back into key[0].
+ **                 8 bytes are done at once as a little endian word,
+ **                 whose shift already carries bits between its bytes
+ **
+ ** Parameters      dst : rotated key, len bytes
+ **                 key : original key
+ **                 len : key size
+ **                 bits : rotation, 0 to 7
+ **
+ ** Returns         none
+ **
+ *******************************************************************************/
+void ecu_xor_key_rotate(unsigned char *dst, const unsigned char *key,
+                        unsigned int len, unsigned int bits);
+
+#endif
@@ -0,0 +1,163 @@
+/*****************************************************************************
+**
+**  Name:           splice_relay.c
+**
+**  Description:    reader of encryptUtil output which moves pages with
+**                  splice(2) instead of copying them, like pv does.
+**                  pages of stdin pipe are moved into holding pipes and
+**                  written to stdout only when every holding pipe is full,
+**                  so writer has time to reuse pages it gave to the pipe.
+**                  output differs from input if writer reuses them.
+**
+**  Copyright  2018, junghoon lee(jhoon.chris@gmail.com)
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+/* Number of holding pipes, they hold more than block pool of writer */
+#define RELAY_PIPE_NUM 64
+
+/* Size of one holding pipe (byte) */
+#define RELAY_PIPE_SIZE (1024*1024)
+
+/* holding pipe */
+struct relay_pipe
+{
+    int fd[2];
+    size_t pending;     /* bytes in pipe */
+};
+
+/* static function definitions */
+static int relay_drain(struct relay_pipe *p);
+
+
+static struct relay_pipe relay_pipes[RELAY_PIPE_NUM];
+
+
+
+/*******************************************************************************
+ **
+ ** Function        main
+ **
+ ** Description     move stdin to stdout through holding pipes by splice()
+ **
+ ** Parameters      none
+ **
+ ** Returns         0 is success
+ **                 1 is error
+ **
+ *******************************************************************************/
+int main()
+{
+    struct pollfd pfd;
+    unsigned int head = 0;  /* oldest holding pipe */
+    unsigned int cur = 0;   /* holding pipe being filled */
+    unsigned int i;
+    int ready = 0;
+    ssize_t len;
+
+    for( i = 0 ; i < RELAY_PIPE_NUM ; i++ )
+    {
+        if( pipe(relay_pipes[i].fd) )
+        {
+            fprintf(stderr, "pipe error %d\n", errno);
+            return 1;
+        }
+        fcntl(relay_pipes[i].fd[1], F_SETPIPE_SZ, RELAY_PIPE_SIZE);
+        relay_pipes[i].pending = 0;
+    }
+    pfd.fd = 0;
+    pfd.events = POLLIN;
+
+    while( 1 )
+    {
+        len = splice(0, NULL, relay_pipes[cur].fd[1], NULL, RELAY_PIPE_SIZE,
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if( len > 0 )
+        {
+            relay_pipes[cur].pending += (size_t)len;
+            ready = 0;
+            continue;
+        }
+        if( len == 0 )
+        {
+            break;
+        }
+        if( errno == EINTR )
+        {
+            continue;
+        }
+        if( errno != EAGAIN )
+        {
+            fprintf(stderr, "splice error %d\n", errno);
+            return 1;
+        }
+
+        /* stdin had data and splice still would block, holding pipe is full */
+        if( ready )
+        {
+            cur = (cur + 1) % RELAY_PIPE_NUM;
+            if( cur == head )
+            {
+                if( relay_drain(&relay_pipes[head]) )
+                {
+                    return 1;
+                }
+                head = (head + 1) % RELAY_PIPE_NUM;
+            }
+            ready = 0;
+            continue;
+        }
+        poll(&pfd, 1, -1);
+        ready = (pfd.revents & POLLIN) ? 1 : 0;
+    }
+
+    for( i = 0 ; i < RELAY_PIPE_NUM ; i++ )
+    {
+        if( relay_drain(&relay_pipes[(head + i) % RELAY_PIPE_NUM]) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*******************************************************************************
+ **
+ ** Function        relay_drain
+ **
+ ** Description     move bytes of holding pipe to stdout
+ **
+ ** Parameters      p : holding pipe
+ **
+ ** Returns         0 is success
+ **                 -1 is error
+ **
+ *******************************************************************************/
+static int relay_drain(struct relay_pipe *p)
+{
+    ssize_t result;
+
+    while( p->pending > 0 )
+    {
+        result = splice(p->fd[0], NULL, 1, NULL, p->pending, SPLICE_F_MOVE);
+        if( result <= 0 )
+        {
+            if( (result < 0) && (errno == EINTR) )
+            {
+                continue;
+            }
+            fprintf(stderr, "splice error %d\n", errno);
+            return -1;
+        }
+        p->pending -= (size_t)result;
+    }
+
+    return 0;
+}